@@ -43,6 +43,16 @@ pushd "$FWDIR" > /dev/null
 # Install SparkR to $LIB_DIR
 "$R_SCRIPT_PATH/R" CMD INSTALL --library="$LIB_DIR" "$FWDIR/pkg/"
 
+# Build the native library and put it into the installed package, where it is loaded along with
+# SparkR. SparkR falls back to its R implementations if the native library cannot be built.
+if make -C "$FWDIR/pkg/src-native" R="$R_SCRIPT_PATH/R" sharelib; then
+  mkdir -p "$LIB_DIR/SparkR/libs"
+  cp "$FWDIR/pkg/src-native/SparkR.so" "$LIB_DIR/SparkR/libs/"
+else
+  echo "Failed to build the SparkR native library, SparkR will use R implementations only"
+fi
+make -C "$FWDIR/pkg/src-native" clean
+
 # Zip the SparkR package so that it can be distributed to worker nodes on YARN
 cd "$LIB_DIR"
 jar cfM "$LIB_DIR/sparkr.zip" SparkR
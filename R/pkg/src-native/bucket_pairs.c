@@ -0,0 +1,103 @@
+/*
+ Licensed to the Apache Software Foundation (ASF) under one or more
+ contributor license agreements.  See the NOTICE file distributed with
+ this work for additional information regarding copyright ownership.
+ The ASF licenses this file to You under the Apache License, Version 2.0
+ (the "License"); you may not use this file except in compliance with
+ the License.  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+/*
+ * The bucketing step of the shuffle in partitionByRDD: splits the key-value pairs of a
+ * partition into lists of the pairs that go to each target partition.
+ */
+
+#include <string.h>
+
+#include "sparkr.h"
+
+/*
+ * Counting sort of `pairs` into `numPartitions` buckets. `buckets` holds the 0-based bucket of
+ * every pair, or is NULL to bucket the pairs by hashCode() of their keys, computed here. The
+ * first pass counts the pairs per bucket so that each bucket list is allocated at its final
+ * size, the second pass scatters the pairs into them. Returns a list of `numPartitions` lists.
+ */
+static SEXP bucketPairsWithScratch(SEXP* args) {
+  SEXP pairs = args[0], buckets = args[1], numPartitions = args[2];
+  R_xlen_t len, i;
+  R_xlen_t unsupported = 0;
+  R_xlen_t* counts;
+  int* bucketOf;
+  int n, b;
+  SEXP result;
+
+  if (TYPEOF(pairs) != VECSXP) {
+    error("invalid input");
+  }
+  len = XLENGTH(pairs);
+  n = asInteger(numPartitions);
+  if (n == NA_INTEGER || n <= 0) {
+    error("invalid number of partitions");
+  }
+
+  if (buckets == R_NilValue) {
+    bucketOf = (int*) scratchAlloc(len * sizeof(int));
+    for (i = 0; i < len; i++) {
+      int supported = 1;
+      int hash = hashKey(pairKey(VECTOR_ELT(pairs, i)), &supported);
+      unsupported += !supported;
+      /* Non-negative modulo, as %% in R and Utils.nonNegativeMod in HashPartitioner. */
+      b = hash % n;
+      bucketOf[i] = b < 0 ? b + n : b;
+    }
+    if (unsupported > 0) {
+      warning("Could not hash %ld object(s), returning 0", (long) unsupported);
+    }
+  } else {
+    if (TYPEOF(buckets) != INTSXP || XLENGTH(buckets) != len) {
+      error("invalid buckets");
+    }
+    bucketOf = INTEGER(buckets);
+    for (i = 0; i < len; i++) {
+      if (bucketOf[i] == NA_INTEGER || bucketOf[i] < 0 || bucketOf[i] >= n) {
+        error("invalid bucket %d for partition count %d", bucketOf[i], n);
+      }
+    }
+  }
+
+  counts = (R_xlen_t*) scratchAlloc(n * sizeof(R_xlen_t));
+  memset(counts, 0, n * sizeof(R_xlen_t));
+  for (i = 0; i < len; i++) {
+    counts[bucketOf[i]]++;
+  }
+
+  result = PROTECT(allocVector(VECSXP, n));
+  for (b = 0; b < n; b++) {
+    SET_VECTOR_ELT(result, b, allocVector(VECSXP, counts[b]));
+    /* Reuse the counts as the next free slot of each bucket. */
+    counts[b] = 0;
+  }
+  for (i = 0; i < len; i++) {
+    b = bucketOf[i];
+    SET_VECTOR_ELT(VECTOR_ELT(result, b), counts[b]++, VECTOR_ELT(pairs, i));
+  }
+
+  UNPROTECT(1);
+  return result;
+}
+
+SEXP bucketPairs(SEXP pairs, SEXP buckets, SEXP numPartitions) {
+  SEXP args[3];
+  args[0] = pairs;
+  args[1] = buckets;
+  args[2] = numPartitions;
+  return callWithScratch(bucketPairsWithScratch, args);
+}
@@ -0,0 +1,122 @@
+/*
+ Licensed to the Apache Software Foundation (ASF) under one or more
+ contributor license agreements.  See the NOTICE file distributed with
+ this work for additional information regarding copyright ownership.
+ The ASF licenses this file to You under the Apache License, Version 2.0
+ (the "License"); you may not use this file except in compliance with
+ the License.  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+/*
+ * Grouping of the key-value pairs of a partition by key for groupByKey, reduceByKey and
+ * combineByKey, with an open-addressing hash table on the hashCode() of the keys.
+ */
+
+#include <limits.h>
+#include <string.h>
+
+#include "sparkr.h"
+
+SEXP pairKey(SEXP pair) {
+  if (TYPEOF(pair) == VECSXP && XLENGTH(pair) > 0) {
+    return VECTOR_ELT(pair, 0);
+  }
+  return pair;
+}
+
+/* Spreads the hash codes over the slots, since they are often small consecutive integers. */
+static R_xlen_t slotOf(int hash, R_xlen_t mask) {
+  unsigned int h = (unsigned int) hash * 0x9E3779B9U;
+  return (R_xlen_t) (h ^ (h >> 16)) & mask;
+}
+
+/*
+ * Assigns every pair of `pairs` the 1-based index of its key among the distinct keys, in the
+ * order of their first appearance. Keys are equal if they are identical(), so keys with
+ * colliding hash codes are kept apart. The table is allocated for all the pairs up front and
+ * is never resized. Returns list(keys = the distinct keys, groups = the index of every pair).
+ */
+static SEXP groupPairKeysWithScratch(SEXP* args) {
+  SEXP pairs = args[0];
+  R_xlen_t len, capacity, mask, i, s;
+  R_xlen_t* slots;
+  int* hashes;
+  int* groups;
+  int numKeys = 0, nextKey;
+  int supported;
+  SEXP groupsVec, keys, result, names;
+
+  if (TYPEOF(pairs) != VECSXP) {
+    error("invalid input");
+  }
+  len = XLENGTH(pairs);
+  if (len >= INT_MAX) {
+    error("too many pairs: %ld", (long) len);
+  }
+
+  /* At most half full, so that probe sequences stay short. */
+  capacity = 8;
+  while (capacity < 2 * len) {
+    capacity *= 2;
+  }
+  mask = capacity - 1;
+  /* Each slot holds the index of the first pair with its key plus one, or 0 if it is free. */
+  slots = (R_xlen_t*) scratchAlloc(capacity * sizeof(R_xlen_t));
+  memset(slots, 0, capacity * sizeof(R_xlen_t));
+  hashes = (int*) scratchAlloc(len * sizeof(int));
+
+  groupsVec = PROTECT(allocVector(INTSXP, len));
+  groups = INTEGER(groupsVec);
+  for (i = 0; i < len; i++) {
+    SEXP key = pairKey(VECTOR_ELT(pairs, i));
+    supported = 1;
+    /* Keys that cannot be hashed all share the hash code 0, but are still compared. */
+    hashes[i] = hashKey(key, &supported);
+    s = slotOf(hashes[i], mask);
+    while (slots[s] != 0) {
+      R_xlen_t first = slots[s] - 1;
+      if (hashes[first] == hashes[i] &&
+          R_compute_identical(pairKey(VECTOR_ELT(pairs, first)), key, 16)) {
+        break;
+      }
+      s = (s + 1) & mask;
+    }
+    if (slots[s] == 0) {
+      slots[s] = i + 1;
+      groups[i] = ++numKeys;
+    } else {
+      groups[i] = groups[slots[s] - 1];
+    }
+  }
+
+  keys = PROTECT(allocVector(VECSXP, numKeys));
+  /* Keys are numbered in the order of their first pairs. */
+  for (i = 0, nextKey = 1; i < len && nextKey <= numKeys; i++) {
+    if (groups[i] == nextKey) {
+      SET_VECTOR_ELT(keys, nextKey - 1, pairKey(VECTOR_ELT(pairs, i)));
+      nextKey++;
+    }
+  }
+
+  result = PROTECT(allocVector(VECSXP, 2));
+  SET_VECTOR_ELT(result, 0, keys);
+  SET_VECTOR_ELT(result, 1, groupsVec);
+  names = PROTECT(allocVector(STRSXP, 2));
+  SET_STRING_ELT(names, 0, mkChar("keys"));
+  SET_STRING_ELT(names, 1, mkChar("groups"));
+  setAttrib(result, R_NamesSymbol, names);
+  UNPROTECT(4);
+  return result;
+}
+
+SEXP groupPairKeys(SEXP pairs) {
+  return callWithScratch(groupPairKeysWithScratch, &pairs);
+}
@@ -0,0 +1,44 @@
+/*
+ Licensed to the Apache Software Foundation (ASF) under one or more
+ contributor license agreements.  See the NOTICE file distributed with
+ this work for additional information regarding copyright ownership.
+ The ASF licenses this file to You under the Apache License, Version 2.0
+ (the "License"); you may not use this file except in compliance with
+ the License.  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+/*
+ * Registers the routines of the SparkR native library, which are called by name with
+ * .Call(name, ..., PACKAGE = "SparkR") from R.
+ */
+
+#include <R_ext/Rdynload.h>
+
+#include "sparkr.h"
+
+static const R_CallMethodDef callMethods[] = {
+  {"stringHashCode", (DL_FUNC) &stringHashCode, 1},
+  {"hashCodes", (DL_FUNC) &hashCodes, 1},
+  {"bucketPairs", (DL_FUNC) &bucketPairs, 3},
+  {"groupPairKeys", (DL_FUNC) &groupPairKeys, 1},
+  {"joinTaggedPairs", (DL_FUNC) &joinTaggedPairs, 2},
+  {"decodeObjects", (DL_FUNC) &decodeObjects, 4},
+  {"decodeColumns", (DL_FUNC) &decodeColumns, 4},
+  {"encodeList", (DL_FUNC) &encodeList, 2},
+  {"resetScratch", (DL_FUNC) &resetScratch, 0},
+  {NULL, NULL, 0}
+};
+
+void R_init_SparkR(DllInfo* dll) {
+  R_registerRoutines(dll, NULL, callMethods, NULL, NULL);
+  R_useDynamicSymbols(dll, FALSE);
+  initStringHashing();
+}
@@ -0,0 +1,161 @@
+/*
+ Licensed to the Apache Software Foundation (ASF) under one or more
+ contributor license agreements.  See the NOTICE file distributed with
+ this work for additional information regarding copyright ownership.
+ The ASF licenses this file to You under the Apache License, Version 2.0
+ (the "License"); you may not use this file except in compliance with
+ the License.  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+/*
+ * The reduce side of joinRDD, leftOuterJoin, rightOuterJoin and fullOuterJoin: sorts the
+ * tagged pairs of a shuffled partition by key and merges the values of both sides of every
+ * key into the joined pairs.
+ */
+
+#include <string.h>
+
+#include "sparkr.h"
+
+/*
+ * Returns the tag of a pair list(K, list(tag, V)), 1 for the left side and 2 for the right
+ * one. Sets *value to V.
+ */
+static int pairTag(SEXP pair, SEXP* value) {
+  SEXP tagged;
+  int tag;
+
+  if (TYPEOF(pair) != VECSXP || XLENGTH(pair) < 2) {
+    error("invalid tagged pair");
+  }
+  tagged = VECTOR_ELT(pair, 1);
+  if (TYPEOF(tagged) != VECSXP || XLENGTH(tagged) < 2) {
+    error("invalid tagged value");
+  }
+  tag = asInteger(VECTOR_ELT(tagged, 0));
+  if (tag != 1 && tag != 2) {
+    error("invalid tag: %d", tag);
+  }
+  *value = VECTOR_ELT(tagged, 1);
+  return tag;
+}
+
+/*
+ * Joins the tagged pairs list(K, list(tag, V)) of a partition by key. The pairs are grouped
+ * with groupPairKeys() and counting sorted by key and then by tag, which keeps their order
+ * otherwise, so that the left and the right values of every key form two adjacent runs. The
+ * runs of each key are then merged into the cartesian product list(K, list(v, w)), one key at
+ * a time, straight into the result, which is allocated at its final size. `nulls` is
+ * c(left, right): if an element is TRUE, the keys without values on that side are still
+ * joined with NULL, as in the outer joins. Keys come in the order of their first pairs.
+ */
+static SEXP joinTaggedPairsWithScratch(SEXP* args) {
+  SEXP pairs = args[0], nulls = args[1];
+  R_xlen_t len, i, j, k, numRuns, numJoined, next;
+  R_xlen_t* runStarts;
+  R_xlen_t* sorted;
+  int* groups;
+  int* tags;
+  int numKeys, nullLeft, nullRight, g;
+  double total = 0;
+  SEXP grouped, keys, result, value;
+
+  if (TYPEOF(pairs) != VECSXP || TYPEOF(nulls) != LGLSXP || XLENGTH(nulls) != 2) {
+    error("invalid input");
+  }
+  len = XLENGTH(pairs);
+  nullLeft = LOGICAL(nulls)[0] == TRUE;
+  nullRight = LOGICAL(nulls)[1] == TRUE;
+
+  grouped = PROTECT(groupPairKeys(pairs));
+  keys = VECTOR_ELT(grouped, 0);
+  groups = INTEGER(VECTOR_ELT(grouped, 1));
+  numKeys = (int) XLENGTH(keys);
+
+  /* Run 2 * (g - 1) holds the left values of key g, the run after it the right ones. */
+  numRuns = 2 * (R_xlen_t) numKeys;
+  runStarts = (R_xlen_t*) scratchAlloc((numRuns + 1) * sizeof(R_xlen_t));
+  memset(runStarts, 0, (numRuns + 1) * sizeof(R_xlen_t));
+  tags = (int*) scratchAlloc(len * sizeof(int));
+  for (i = 0; i < len; i++) {
+    tags[i] = pairTag(VECTOR_ELT(pairs, i), &value);
+    runStarts[2 * (R_xlen_t) (groups[i] - 1) + tags[i]]++;
+  }
+  for (k = 0; k < numKeys; k++) {
+    R_xlen_t numLeft = runStarts[2 * k + 1];
+    R_xlen_t numRight = runStarts[2 * k + 2];
+    if (numLeft == 0 && nullLeft) {
+      numLeft = 1;
+    }
+    if (numRight == 0 && nullRight) {
+      numRight = 1;
+    }
+    total += (double) numLeft * (double) numRight;
+  }
+  if (total > (double) R_XLEN_T_MAX) {
+    error("too many joined pairs: %.0f", total);
+  }
+  numJoined = (R_xlen_t) total;
+  for (k = 0; k < numRuns; k++) {
+    runStarts[k + 1] += runStarts[k];
+  }
+
+  /* After the scatter, runStarts[r] is the end of run r and thus the start of run r + 1. */
+  sorted = (R_xlen_t*) scratchAlloc(len * sizeof(R_xlen_t));
+  for (i = 0; i < len; i++) {
+    sorted[runStarts[2 * (R_xlen_t) (groups[i] - 1) + tags[i] - 1]++] = i;
+  }
+
+  result = PROTECT(allocVector(VECSXP, numJoined));
+  next = 0;
+  for (g = 0; g < numKeys; g++) {
+    SEXP key = VECTOR_ELT(keys, g);
+    R_xlen_t leftStart = g == 0 ? 0 : runStarts[2 * (R_xlen_t) g - 1];
+    R_xlen_t leftEnd = runStarts[2 * (R_xlen_t) g];
+    R_xlen_t rightEnd = runStarts[2 * (R_xlen_t) g + 1];
+    /* A side without values is joined once as NULL in the outer joins, or not at all. */
+    int leftMissing = leftStart == leftEnd;
+    int rightMissing = leftEnd == rightEnd;
+    if ((leftMissing && !nullLeft) || (rightMissing && !nullRight)) {
+      continue;
+    }
+    for (i = leftStart; i < leftEnd || (leftMissing && i == leftStart); i++) {
+      SEXP left = R_NilValue;
+      if (!leftMissing) {
+        pairTag(VECTOR_ELT(pairs, sorted[i]), &left);
+      }
+      for (j = leftEnd; j < rightEnd || (rightMissing && j == leftEnd); j++) {
+        SEXP right = R_NilValue, joined, item;
+        if (!rightMissing) {
+          pairTag(VECTOR_ELT(pairs, sorted[j]), &right);
+        }
+        joined = PROTECT(allocVector(VECSXP, 2));
+        SET_VECTOR_ELT(joined, 0, left);
+        SET_VECTOR_ELT(joined, 1, right);
+        item = PROTECT(allocVector(VECSXP, 2));
+        SET_VECTOR_ELT(item, 0, key);
+        SET_VECTOR_ELT(item, 1, joined);
+        SET_VECTOR_ELT(result, next++, item);
+        UNPROTECT(2);
+      }
+    }
+  }
+
+  UNPROTECT(2);
+  return result;
+}
+
+SEXP joinTaggedPairs(SEXP pairs, SEXP nulls) {
+  SEXP args[2];
+  args[0] = pairs;
+  args[1] = nulls;
+  return callWithScratch(joinTaggedPairsWithScratch, args);
+}
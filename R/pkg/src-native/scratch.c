@@ -0,0 +1,221 @@
+/*
+ Licensed to the Apache Software Foundation (ASF) under one or more
+ contributor license agreements.  See the NOTICE file distributed with
+ this work for additional information regarding copyright ownership.
+ The ASF licenses this file to You under the Apache License, Version 2.0
+ (the "License"); you may not use this file except in compliance with
+ the License.  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+/*
+ * The scratch memory of the native routines: a stack of chunks allocated with malloc() that
+ * every call allocates its temporary buffers from, and releases them to when it returns or
+ * fails, so that the chunks are reused by the next calls instead of R_alloc() allocating R
+ * vectors for the garbage collector each time. The R worker resets it after every task, and
+ * the chunks beyond a bound are freed whenever no routine is running.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sparkr.h"
+
+/* The size of the first chunk. Every further chunk is at least twice as large as the last. */
+#define SCRATCH_MIN_CHUNK_SIZE ((size_t) 1 << 16)
+/* A reset keeps the chunks in a single chunk of their total size, up to this size. */
+#define SCRATCH_MAX_RETAINED_SIZE ((size_t) 64 << 20)
+/* Allocations are rounded up to keep every buffer aligned for any type. */
+#define SCRATCH_ALIGNMENT 16
+
+typedef struct {
+  char* data;
+  size_t size;
+} Chunk;
+
+static Chunk* chunks = NULL;
+static int numChunks = 0;
+static int chunksCapacity = 0;
+/* The chunk allocated from, or -1 before the first allocation, and how much of it is used. */
+static int current = -1;
+static size_t used = 0;
+/* The total size of the chunks before the current one. */
+static size_t base = 0;
+/* The largest base + used since the last reset. */
+static size_t peak = 0;
+
+static size_t alignedSize(size_t size) {
+  return (size + SCRATCH_ALIGNMENT - 1) & ~((size_t) SCRATCH_ALIGNMENT - 1);
+}
+
+/* Makes chunks[index] a new chunk of at least `size` bytes, replacing any smaller one there. */
+static void newChunk(int index, size_t size) {
+  size_t chunkSize = SCRATCH_MIN_CHUNK_SIZE;
+  char* data;
+
+  if (index > 0 && chunkSize < 2 * chunks[index - 1].size) {
+    chunkSize = 2 * chunks[index - 1].size;
+  }
+  if (chunkSize < size) {
+    chunkSize = size;
+  }
+  if (index == chunksCapacity) {
+    int capacity = chunksCapacity > 0 ? 2 * chunksCapacity : 8;
+    Chunk* grown = (Chunk*) realloc(chunks, capacity * sizeof(Chunk));
+    if (grown == NULL) {
+      error("cannot allocate native scratch memory");
+    }
+    chunks = grown;
+    chunksCapacity = capacity;
+  }
+  data = (char*) malloc(chunkSize);
+  if (data == NULL) {
+    error("cannot allocate %.0f bytes of native scratch memory", (double) chunkSize);
+  }
+  if (index < numChunks) {
+    free(chunks[index].data);
+  } else {
+    numChunks = index + 1;
+  }
+  chunks[index].data = data;
+  chunks[index].size = chunkSize;
+}
+
+ScratchMark scratchMark(void) {
+  ScratchMark mark;
+  mark.chunk = current;
+  mark.used = used;
+  mark.base = base;
+  return mark;
+}
+
+void scratchRelease(ScratchMark mark) {
+  int retained = 0, i;
+  size_t total = 0;
+
+  current = mark.chunk;
+  used = mark.used;
+  base = mark.base;
+  if (current >= 0) {
+    return;
+  }
+  /*
+   * With no routine running, the chunks beyond SCRATCH_MAX_RETAINED_SIZE in total are freed, as
+   * the driver, which encodes every call to the JVM here, never resets the scratch memory.
+   */
+  while (retained < numChunks && total + chunks[retained].size <= SCRATCH_MAX_RETAINED_SIZE) {
+    total += chunks[retained].size;
+    retained++;
+  }
+  for (i = retained; i < numChunks; i++) {
+    free(chunks[i].data);
+  }
+  numChunks = retained;
+}
+
+void* scratchAlloc(size_t size) {
+  void* ptr;
+
+  size = alignedSize(size > 0 ? size : 1);
+  if (current < 0 || used + size > chunks[current].size) {
+    /* The rest of the current chunk is left unused until it is released. */
+    int next = current + 1;
+    if (next == numChunks || chunks[next].size < size) {
+      newChunk(next, size);
+    }
+    if (current >= 0) {
+      base += chunks[current].size;
+    }
+    current = next;
+    used = 0;
+  }
+  ptr = chunks[current].data + used;
+  used += size;
+  if (base + used > peak) {
+    peak = base + used;
+  }
+  return ptr;
+}
+
+void* scratchGrow(void* ptr, size_t oldSize, size_t newSize) {
+  void* grown;
+
+  oldSize = alignedSize(oldSize > 0 ? oldSize : 1);
+  /* The last buffer allocated grows in place if the current chunk has room for it. */
+  if (ptr != NULL && current >= 0 && (char*) ptr + oldSize == chunks[current].data + used &&
+      used - oldSize + alignedSize(newSize) <= chunks[current].size) {
+    used = used - oldSize + alignedSize(newSize);
+    if (base + used > peak) {
+      peak = base + used;
+    }
+    return ptr;
+  }
+  grown = scratchAlloc(newSize);
+  if (ptr != NULL) {
+    memcpy(grown, ptr, oldSize < newSize ? oldSize : newSize);
+  }
+  return grown;
+}
+
+typedef struct {
+  SEXP (*fun)(SEXP* args);
+  SEXP* args;
+} ScratchCall;
+
+static SEXP runScratchCall(void* data) {
+  ScratchCall* call = (ScratchCall*) data;
+  return call->fun(call->args);
+}
+
+static void releaseScratchMark(void* data) {
+  scratchRelease(*(ScratchMark*) data);
+}
+
+SEXP callWithScratch(SEXP (*fun)(SEXP* args), SEXP* args) {
+  ScratchCall call;
+  ScratchMark mark = scratchMark();
+  call.fun = fun;
+  call.args = args;
+  /* The cleanup also runs when fun() fails with an R error, e.g. in R code that it calls. */
+  return R_ExecWithCleanup(runScratchCall, &call, releaseScratchMark, &mark);
+}
+
+/*
+ * Releases all the scratch memory and returns its peak use in bytes since the last reset. Must
+ * not be called while a native routine is running, i.e. from R code that they call back.
+ */
+SEXP resetScratch(void) {
+  size_t total = 0;
+  double peakUse = (double) peak;
+  int i;
+
+  for (i = 0; i < numChunks; i++) {
+    total += chunks[i].size;
+  }
+  if (numChunks > 1 || total > SCRATCH_MAX_RETAINED_SIZE) {
+    /* Consolidated, so that as much scratch memory fits in the first chunk next time. */
+    for (i = 0; i < numChunks; i++) {
+      free(chunks[i].data);
+    }
+    numChunks = 0;
+    if (total <= SCRATCH_MAX_RETAINED_SIZE) {
+      chunks[0].data = (char*) malloc(total);
+      if (chunks[0].data != NULL) {
+        chunks[0].size = total;
+        numChunks = 1;
+      }
+    }
+  }
+  current = -1;
+  used = 0;
+  base = 0;
+  peak = 0;
+  return ScalarReal(peakUse);
+}
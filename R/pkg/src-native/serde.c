@@ -0,0 +1,828 @@
+/*
+ Licensed to the Apache Software Foundation (ASF) under one or more
+ contributor license agreements.  See the NOTICE file distributed with
+ this work for additional information regarding copyright ownership.
+ The ASF licenses this file to You under the Apache License, Version 2.0
+ (the "License"); you may not use this file except in compliance with
+ the License.  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+/*
+ * Native codec for the SerDe wire format shared with the JVM (see SerDe.scala), producing the
+ * same objects and bytes as deserialize.R and serialize.R. Values are big-endian and prefixed
+ * by a one byte type.
+ *
+ * The codec works on whole raw vectors instead of connections. The plain types (NULL, integer,
+ * character, logical, numeric, raw and lists) are handled here; dates, times, structs, jobjs,
+ * environments and classed objects are passed back to the R implementation, evaluated in `rho`.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "sparkr.h"
+
+typedef struct {
+  const unsigned char* data;
+  R_xlen_t len;
+  R_xlen_t pos;
+  SEXP rho;
+} InputBuffer;
+
+typedef struct {
+  unsigned char* data;
+  R_xlen_t len;
+  R_xlen_t capacity;
+  SEXP rho;
+} OutputBuffer;
+
+/* A list that grows by doubling while it is filled, protected at `index`. */
+typedef struct {
+  SEXP list;
+  R_xlen_t size;
+  PROTECT_INDEX index;
+} ListBuilder;
+
+static SEXP readObjectFrom(InputBuffer* in);
+static void writeObjectTo(OutputBuffer* out, SEXP object, int writeType);
+
+static void listBuilderInit(ListBuilder* builder) {
+  builder->size = 0;
+  builder->list = allocVector(VECSXP, 16);
+  PROTECT_WITH_INDEX(builder->list, &builder->index);
+}
+
+static void listBuilderAppend(ListBuilder* builder, SEXP value) {
+  if (builder->size == XLENGTH(builder->list)) {
+    PROTECT(value);
+    builder->list = xlengthgets(builder->list, 2 * builder->size);
+    REPROTECT(builder->list, builder->index);
+    UNPROTECT(1);
+  }
+  SET_VECTOR_ELT(builder->list, builder->size++, value);
+}
+
+/* Returns the list built so far, of its final length, and leaves it protected. */
+static SEXP listBuilderFinish(ListBuilder* builder) {
+  builder->list = xlengthgets(builder->list, builder->size);
+  REPROTECT(builder->list, builder->index);
+  return builder->list;
+}
+
+/* Evaluates fun(arg) in rho, e.g. to call the R implementation for the types not handled here. */
+static SEXP callR(const char* fun, SEXP arg, SEXP rho) {
+  SEXP call = PROTECT(lang2(install(fun), arg));
+  SEXP result = eval(call, rho);
+  UNPROTECT(1);
+  return result;
+}
+
+/* ---- Deserialization ---- */
+
+static void ensureAvailable(InputBuffer* in, R_xlen_t n) {
+  if (n < 0 || in->len - in->pos < n) {
+    error("Unexpected end of input while deserializing");
+  }
+}
+
+static int readIntFrom(InputBuffer* in) {
+  const unsigned char* p;
+  ensureAvailable(in, 4);
+  p = in->data + in->pos;
+  in->pos += 4;
+  return (int) (((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) |
+                ((uint32_t) p[2] << 8) | (uint32_t) p[3]);
+}
+
+static double readDoubleFrom(InputBuffer* in) {
+  const unsigned char* p;
+  uint64_t bits = 0;
+  double value;
+  int i;
+  ensureAvailable(in, 8);
+  p = in->data + in->pos;
+  in->pos += 8;
+  for (i = 0; i < 8; i++) {
+    bits = (bits << 8) | p[i];
+  }
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static char readTypeFrom(InputBuffer* in) {
+  ensureAvailable(in, 1);
+  return (char) in->data[in->pos++];
+}
+
+/* As readString(): trailing nuls, written by R, are dropped as rawToChar() does. */
+static SEXP readStringFrom(InputBuffer* in) {
+  const char* str;
+  int len = readIntFrom(in);
+  int end;
+  ensureAvailable(in, len);
+  str = (const char*) in->data + in->pos;
+  in->pos += len;
+  end = len;
+  while (end > 0 && str[end - 1] == '\0') {
+    end--;
+  }
+  if (memchr(str, '\0', end) != NULL) {
+    error("embedded nul in string");
+  }
+  return mkCharLenCE(str, end, CE_UTF8);
+}
+
+static SEXP readRawFrom(InputBuffer* in) {
+  int len = readIntFrom(in);
+  SEXP raw;
+  ensureAvailable(in, len);
+  raw = allocVector(RAWSXP, len);
+  memcpy(RAW(raw), in->data + in->pos, len);
+  in->pos += len;
+  return raw;
+}
+
+static SEXP readTimeFrom(InputBuffer* in) {
+  SEXP time = PROTECT(ScalarReal(readDoubleFrom(in)));
+  SEXP call = PROTECT(lang3(install("as.POSIXct"), time, mkString("1970-01-01")));
+  SEXP result;
+  SET_TAG(CDDR(call), install("origin"));
+  result = eval(call, in->rho);
+  UNPROTECT(2);
+  return result;
+}
+
+static SEXP readEnvFrom(InputBuffer* in) {
+  SEXP call = PROTECT(lang1(install("new.env")));
+  SEXP env = PROTECT(eval(call, in->rho));
+  int len = readIntFrom(in);
+  int i;
+  for (i = 0; i < len; i++) {
+    SEXP key = PROTECT(readStringFrom(in));
+    SEXP value = PROTECT(readObjectFrom(in));
+    defineVar(install(translateChar(key)), value, env);
+    UNPROTECT(2);
+  }
+  UNPROTECT(2);
+  return env;
+}
+
+static SEXP readStructFrom(InputBuffer* in) {
+  SEXP names = PROTECT(readObjectFrom(in));
+  SEXP fields = PROTECT(readObjectFrom(in));
+  SEXP call = PROTECT(lang3(install("names<-"), fields, names));
+  SEXP result = PROTECT(eval(call, in->rho));
+  result = callR("listToStruct", result, in->rho);
+  UNPROTECT(4);
+  return result;
+}
+
+static SEXP readTypedObjectFrom(InputBuffer* in, char type) {
+  SEXP result, elem;
+  int len, i;
+  char elemType;
+
+  switch (type) {
+    case 'i':
+      return ScalarInteger(readIntFrom(in));
+    case 'c':
+      return ScalarString(readStringFrom(in));
+    case 'b':
+      i = readIntFrom(in);
+      return ScalarLogical(i == NA_INTEGER ? NA_LOGICAL : i != 0);
+    case 'd':
+      return ScalarReal(readDoubleFrom(in));
+    case 'r':
+      return readRawFrom(in);
+    case 'D':
+      result = PROTECT(ScalarString(readStringFrom(in)));
+      result = callR("as.Date", result, in->rho);
+      UNPROTECT(1);
+      return result;
+    case 't':
+      return readTimeFrom(in);
+    case 'a':
+      elemType = readTypeFrom(in);
+      len = readIntFrom(in);
+      result = PROTECT(allocVector(VECSXP, len > 0 ? len : 0));
+      for (i = 0; i < len; i++) {
+        SET_VECTOR_ELT(result, i, readTypedObjectFrom(in, elemType));
+      }
+      UNPROTECT(1);
+      return result;
+    case 'l':
+      len = readIntFrom(in);
+      result = PROTECT(allocVector(VECSXP, len > 0 ? len : 0));
+      for (i = 0; i < len; i++) {
+        elem = readObjectFrom(in);
+        /* Null objects are read as NA. */
+        SET_VECTOR_ELT(result, i, elem == R_NilValue ? ScalarLogical(NA_LOGICAL) : elem);
+      }
+      UNPROTECT(1);
+      return result;
+    case 'e':
+      return readEnvFrom(in);
+    case 's':
+      return readStructFrom(in);
+    case 'n':
+      return R_NilValue;
+    case 'j':
+      result = PROTECT(ScalarString(readStringFrom(in)));
+      result = callR("getJobj", result, in->rho);
+      UNPROTECT(1);
+      return result;
+    default:
+      error("Unsupported type for deserialization %c", type);
+  }
+  return R_NilValue;
+}
+
+static SEXP readObjectFrom(InputBuffer* in) {
+  return readTypedObjectFrom(in, readTypeFrom(in));
+}
+
+/* Returns list(keys = keys, data = data). */
+static SEXP keysAndData(SEXP keys, SEXP data) {
+  SEXP result = PROTECT(allocVector(VECSXP, 2));
+  SEXP names = PROTECT(allocVector(STRSXP, 2));
+  SET_VECTOR_ELT(result, 0, keys);
+  SET_VECTOR_ELT(result, 1, data);
+  SET_STRING_ELT(names, 0, mkChar("keys"));
+  SET_STRING_ELT(names, 1, mkChar("data"));
+  setAttrib(result, R_NamesSymbol, names);
+  UNPROTECT(2);
+  return result;
+}
+
+/*
+ * Reads `count` typed objects from the raw vector `bytes`, or all of them if `count` is
+ * negative, as readMultipleObjects() does. With `withKeys`, reads groups of objects each
+ * followed by a grouping key, as readMultipleObjectsWithKeys() does.
+ */
+SEXP decodeObjects(SEXP bytes, SEXP count, SEXP withKeys, SEXP rho) {
+  InputBuffer in;
+  ListBuilder data, keys, subData;
+  R_xlen_t n, i;
+  SEXP result;
+  char type;
+
+  if (TYPEOF(bytes) != RAWSXP) {
+    error("invalid input");
+  }
+  in.data = RAW(bytes);
+  in.len = XLENGTH(bytes);
+  in.pos = 0;
+  in.rho = rho;
+  n = (R_xlen_t) asReal(count);
+
+  if (!asLogical(withKeys)) {
+    listBuilderInit(&data);
+    for (i = 0; n < 0 ? in.pos < in.len : i < n; i++) {
+      listBuilderAppend(&data, readObjectFrom(&in));
+    }
+    result = listBuilderFinish(&data);
+    UNPROTECT(1);
+    return result;
+  }
+
+  listBuilderInit(&keys);
+  listBuilderInit(&data);
+  listBuilderInit(&subData);
+  while (in.pos < in.len) {
+    type = readTypeFrom(&in);
+    if (type == 'r') {
+      /* A grouping boundary */
+      listBuilderAppend(&keys, readObjectFrom(&in));
+      listBuilderAppend(&data, listBuilderFinish(&subData));
+      UNPROTECT(1);
+      listBuilderInit(&subData);
+    } else {
+      listBuilderAppend(&subData, readTypedObjectFrom(&in, type));
+    }
+  }
+  result = keysAndData(listBuilderFinish(&keys), listBuilderFinish(&data));
+  UNPROTECT(3);
+  return result;
+}
+
+/* ---- Column-wise decoding of rows ---- */
+
+/*
+ * The columns of a data.frame being decoded row by row, kept in a protected list and grown by
+ * doubling. A column is of type NILSXP while it only holds NAs, stored as logicals, and else of
+ * the type of its values: LGLSXP, INTSXP, REALSXP, STRSXP, or VECSXP for raw values.
+ */
+typedef struct {
+  SEXP columns;
+  PROTECT_INDEX index;
+  int* types;
+  int numCols;
+  R_xlen_t numRows;
+  R_xlen_t capacity;
+} FrameBuilder;
+
+static void frameBuilderReset(FrameBuilder* frame) {
+  int j;
+  frame->numRows = 0;
+  frame->capacity = 16;
+  frame->columns = allocVector(VECSXP, frame->numCols);
+  REPROTECT(frame->columns, frame->index);
+  for (j = 0; j < frame->numCols; j++) {
+    frame->types[j] = NILSXP;
+    SET_VECTOR_ELT(frame->columns, j, allocVector(LGLSXP, frame->capacity));
+  }
+}
+
+static void frameBuilderInit(FrameBuilder* frame, int numCols) {
+  frame->numCols = numCols;
+  frame->types = (int*) scratchAlloc(numCols * sizeof(int));
+  PROTECT_WITH_INDEX(R_NilValue, &frame->index);
+  frameBuilderReset(frame);
+}
+
+static void frameBuilderGrow(FrameBuilder* frame) {
+  int j;
+  frame->capacity *= 2;
+  for (j = 0; j < frame->numCols; j++) {
+    SET_VECTOR_ELT(frame->columns, j,
+                   xlengthgets(VECTOR_ELT(frame->columns, j), frame->capacity));
+  }
+}
+
+/*
+ * The type of a column of type `columnType` once a value of type `valueType` is added, as
+ * rbind() coerces logical to integer to double, or NILSXP if they cannot be combined here.
+ */
+static int combinedType(int columnType, int valueType) {
+  int numeric = (columnType == LGLSXP || columnType == INTSXP || columnType == REALSXP) &&
+                (valueType == LGLSXP || valueType == INTSXP || valueType == REALSXP);
+  if (columnType == NILSXP || columnType == valueType) {
+    return valueType;
+  }
+  if (numeric) {
+    return columnType > valueType ? columnType : valueType;
+  }
+  return NILSXP;
+}
+
+/*
+ * Reads a row, i.e. a list, into the columns. Returns 0 if the row does not fit them: it is
+ * not of the same width, or has a value of another or of a nested type.
+ */
+static int readRowInto(InputBuffer* in, FrameBuilder* frame) {
+  R_xlen_t row = frame->numRows;
+  SEXP column, value = R_NilValue;
+  double realValue = 0;
+  int intValue = 0;
+  int j, type, target;
+
+  if (readIntFrom(in) != frame->numCols) {
+    return 0;
+  }
+  if (row == frame->capacity) {
+    frameBuilderGrow(frame);
+  }
+  for (j = 0; j < frame->numCols; j++) {
+    switch (readTypeFrom(in)) {
+      case 'n':
+        type = NILSXP;
+        break;
+      case 'b':
+        intValue = readIntFrom(in);
+        intValue = intValue == NA_INTEGER ? NA_LOGICAL : intValue != 0;
+        type = LGLSXP;
+        break;
+      case 'i':
+        intValue = readIntFrom(in);
+        type = INTSXP;
+        break;
+      case 'd':
+        realValue = readDoubleFrom(in);
+        type = REALSXP;
+        break;
+      case 'c':
+        value = readStringFrom(in);
+        type = STRSXP;
+        break;
+      case 'r':
+        value = readRawFrom(in);
+        type = VECSXP;
+        break;
+      default:
+        return 0;
+    }
+
+    if (type != NILSXP && type != frame->types[j]) {
+      target = combinedType(frame->types[j], type);
+      if (target == NILSXP) {
+        return 0;
+      }
+      PROTECT(value);
+      SET_VECTOR_ELT(frame->columns, j, coerceVector(VECTOR_ELT(frame->columns, j), target));
+      UNPROTECT(1);
+      frame->types[j] = target;
+    }
+
+    column = VECTOR_ELT(frame->columns, j);
+    switch (TYPEOF(column)) {
+      case LGLSXP:
+        LOGICAL(column)[row] = type == NILSXP ? NA_LOGICAL : intValue;
+        break;
+      case INTSXP:
+        INTEGER(column)[row] = type == NILSXP ? NA_INTEGER : intValue;
+        break;
+      case REALSXP:
+        if (type == REALSXP) {
+          REAL(column)[row] = realValue;
+        } else {
+          REAL(column)[row] = type == NILSXP || intValue == NA_INTEGER ? NA_REAL : intValue;
+        }
+        break;
+      case STRSXP:
+        SET_STRING_ELT(column, row, type == NILSXP ? NA_STRING : value);
+        break;
+      default:
+        SET_VECTOR_ELT(column, row, type == NILSXP ? ScalarLogical(NA_LOGICAL) : value);
+        break;
+    }
+  }
+  frame->numRows++;
+  return 1;
+}
+
+/* Returns the rows read so far as a data.frame with the given column names. */
+static SEXP frameBuilderFinish(FrameBuilder* frame, SEXP colNames) {
+  SEXP df = PROTECT(allocVector(VECSXP, frame->numCols));
+  SEXP rowNames;
+  int j;
+
+  for (j = 0; j < frame->numCols; j++) {
+    SET_VECTOR_ELT(df, j, xlengthgets(VECTOR_ELT(frame->columns, j), frame->numRows));
+  }
+  setAttrib(df, R_NamesSymbol, colNames);
+  /* Compact automatic row names, c(NA, -numRows). */
+  rowNames = PROTECT(allocVector(INTSXP, frame->numRows > 0 ? 2 : 0));
+  if (frame->numRows > 0) {
+    INTEGER(rowNames)[0] = NA_INTEGER;
+    INTEGER(rowNames)[1] = (int) -frame->numRows;
+  }
+  setAttrib(df, R_RowNamesSymbol, rowNames);
+  classgets(df, PROTECT(mkString("data.frame")));
+  UNPROTECT(3);
+  return df;
+}
+
+/* decodeColumns(), with the types of the columns in scratch memory. */
+static SEXP decodeFrames(SEXP* args) {
+  SEXP bytes = args[0], colNames = args[1], withKeys = args[2], rho = args[3];
+  InputBuffer in;
+  FrameBuilder frame;
+  ListBuilder keys, frames;
+  SEXP result;
+  char type;
+
+  if (TYPEOF(bytes) != RAWSXP || TYPEOF(colNames) != STRSXP) {
+    error("invalid input");
+  }
+  in.data = RAW(bytes);
+  in.len = XLENGTH(bytes);
+  in.pos = 0;
+  in.rho = rho;
+  frameBuilderInit(&frame, LENGTH(colNames));
+
+  if (!asLogical(withKeys)) {
+    while (in.pos < in.len) {
+      if (readTypeFrom(&in) != 'l' || !readRowInto(&in, &frame)) {
+        UNPROTECT(1);
+        return R_NilValue;
+      }
+    }
+    result = frameBuilderFinish(&frame, colNames);
+    UNPROTECT(1);
+    return result;
+  }
+
+  listBuilderInit(&keys);
+  listBuilderInit(&frames);
+  while (in.pos < in.len) {
+    type = readTypeFrom(&in);
+    if (type == 'r') {
+      /* A grouping boundary */
+      listBuilderAppend(&keys, readObjectFrom(&in));
+      listBuilderAppend(&frames, frameBuilderFinish(&frame, colNames));
+      frameBuilderReset(&frame);
+    } else if (type != 'l' || !readRowInto(&in, &frame)) {
+      UNPROTECT(3);
+      return R_NilValue;
+    }
+  }
+  result = keysAndData(listBuilderFinish(&keys), listBuilderFinish(&frames));
+  UNPROTECT(3);
+  return result;
+}
+
+/*
+ * Reads the rows in the raw vector `bytes` into a data.frame with the names `colNames`, as
+ * readMultipleObjects() followed by rbind() produce. Each column takes the type of its first
+ * non-NA value and is widened as rbind() does when a later value is of a wider type, from
+ * logical to integer to double. Columns of only NA values are logical, and raw values are in
+ * list columns as rbindRaws() makes them. With `withKeys`, reads the groups of rows as
+ * readMultipleObjectsWithKeys() does and returns list(keys = , data = ) with a data.frame per
+ * group.
+ *
+ * Returns NULL if the rows cannot be decoded column by column, e.g. if they hold dates, nested
+ * values or a column mixing strings and numbers, in which case they should be decoded as lists
+ * with decodeObjects().
+ */
+SEXP decodeColumns(SEXP bytes, SEXP colNames, SEXP withKeys, SEXP rho) {
+  SEXP args[4];
+  args[0] = bytes;
+  args[1] = colNames;
+  args[2] = withKeys;
+  args[3] = rho;
+  return callWithScratch(decodeFrames, args);
+}
+
+/* ---- Serialization ---- */
+
+static void ensureCapacity(OutputBuffer* out, R_xlen_t n) {
+  R_xlen_t capacity;
+  if (out->len + n <= out->capacity) {
+    return;
+  }
+  capacity = 2 * out->capacity > out->len + n ? 2 * out->capacity : out->len + n;
+  out->data = (unsigned char*) scratchGrow(out->data, out->capacity, capacity);
+  out->capacity = capacity;
+}
+
+static void writeBytesTo(OutputBuffer* out, const void* bytes, R_xlen_t n) {
+  ensureCapacity(out, n);
+  memcpy(out->data + out->len, bytes, n);
+  out->len += n;
+}
+
+static void writeIntTo(OutputBuffer* out, int value) {
+  uint32_t bits = (uint32_t) value;
+  unsigned char p[4];
+  p[0] = (unsigned char) (bits >> 24);
+  p[1] = (unsigned char) (bits >> 16);
+  p[2] = (unsigned char) (bits >> 8);
+  p[3] = (unsigned char) bits;
+  writeBytesTo(out, p, 4);
+}
+
+static void writeDoubleTo(OutputBuffer* out, double value) {
+  uint64_t bits;
+  unsigned char p[8];
+  int i;
+  memcpy(&bits, &value, sizeof(bits));
+  for (i = 7; i >= 0; i--) {
+    p[i] = (unsigned char) bits;
+    bits >>= 8;
+  }
+  writeBytesTo(out, p, 8);
+}
+
+/* As writeString(): the length includes the nul terminator, which is written too. */
+static void writeStringTo(OutputBuffer* out, SEXP charsxp) {
+  const char* str = getCharCE(charsxp) == CE_BYTES ? CHAR(charsxp) : translateCharUTF8(charsxp);
+  R_xlen_t len = (R_xlen_t) strlen(str);
+  writeIntTo(out, (int) (len + 1));
+  writeBytesTo(out, str, len + 1);
+}
+
+/*
+ * Whether `object` is of one of the types handled here: unclassed NULL, atomic vectors other
+ * than complex, and lists. Anything else goes through the R implementation.
+ */
+static int isPlain(SEXP object) {
+  switch (TYPEOF(object)) {
+    case NILSXP:
+      return 1;
+    case LGLSXP:
+    case INTSXP:
+    case REALSXP:
+    case STRSXP:
+    case RAWSXP:
+    case VECSXP:
+      return !OBJECT(object) && getAttrib(object, R_DimSymbol) == R_NilValue;
+    default:
+      return 0;
+  }
+}
+
+/* class(object)[[1]] of a plain object. */
+static const char* plainClass(SEXP object) {
+  switch (TYPEOF(object)) {
+    case LGLSXP:
+      return "logical";
+    case INTSXP:
+      return "integer";
+    case REALSXP:
+      return "numeric";
+    case STRSXP:
+      return "character";
+    case RAWSXP:
+      return "raw";
+    case VECSXP:
+      return "list";
+    default:
+      return "NULL";
+  }
+}
+
+/* As getSerdeType(). */
+static const char* serdeType(SEXP object, SEXP rho) {
+  SEXP type;
+  const char* elemType = NULL;
+  char* copy;
+  R_xlen_t i;
+
+  if (!isPlain(object)) {
+    type = PROTECT(callR("getSerdeType", object, rho));
+    /*
+     * Copied, as the CHARSXP is only protected as long as `type` is. Not in scratch memory,
+     * so that the output buffer, the last one allocated there, can still grow in place.
+     */
+    copy = R_alloc(strlen(CHAR(STRING_ELT(type, 0))) + 1, sizeof(char));
+    strcpy(copy, CHAR(STRING_ELT(type, 0)));
+    UNPROTECT(1);
+    return copy;
+  }
+  if (TYPEOF(object) != VECSXP) {
+    return TYPEOF(object) != RAWSXP && XLENGTH(object) > 1 ? "array" : plainClass(object);
+  }
+  /* A list is an array if all of its elements are of the same type. */
+  for (i = 0; i < XLENGTH(object); i++) {
+    const char* type = serdeType(VECTOR_ELT(object, i), rho);
+    if (elemType != NULL && strcmp(type, elemType) != 0) {
+      return "list";
+    }
+    elemType = type;
+  }
+  return "array";
+}
+
+/* As writeType(). */
+static void writeTypeTo(OutputBuffer* out, const char* type) {
+  static const char* const names[] = {
+    "NULL", "integer", "character", "logical", "double", "numeric", "raw", "array", "list",
+    "struct", "jobj", "environment", "Date", "POSIXlt", "POSIXct"
+  };
+  static const char codes[] = "nicbddralsjeDtt";
+  size_t i;
+  for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    if (strcmp(type, names[i]) == 0) {
+      writeBytesTo(out, &codes[i], 1);
+      return;
+    }
+  }
+  error("Unsupported type for serialization %s", type);
+}
+
+/* Whether the first element of an atomic vector is NA, which is what is.na() checks there. */
+static int firstIsNA(SEXP object) {
+  switch (TYPEOF(object)) {
+    case LGLSXP:
+      return LOGICAL(object)[0] == NA_LOGICAL;
+    case INTSXP:
+      return INTEGER(object)[0] == NA_INTEGER;
+    case REALSXP:
+      return ISNAN(REAL(object)[0]);
+    case STRSXP:
+      return STRING_ELT(object, 0) == NA_STRING;
+    default:
+      return 0;
+  }
+}
+
+/* Writes element i of an atomic vector as writeObject(con, arr[[i]], FALSE) does. */
+static void writeAtomicElementTo(OutputBuffer* out, SEXP arr, R_xlen_t i) {
+  switch (TYPEOF(arr)) {
+    case LGLSXP:
+      if (LOGICAL(arr)[i] != NA_LOGICAL) {
+        writeIntTo(out, LOGICAL(arr)[i]);
+      }
+      break;
+    case INTSXP:
+      if (INTEGER(arr)[i] != NA_INTEGER) {
+        writeIntTo(out, INTEGER(arr)[i]);
+      }
+      break;
+    case REALSXP:
+      if (!ISNAN(REAL(arr)[i])) {
+        writeDoubleTo(out, REAL(arr)[i]);
+      }
+      break;
+    case STRSXP:
+      if (STRING_ELT(arr, i) != NA_STRING) {
+        writeStringTo(out, STRING_ELT(arr, i));
+      }
+      break;
+  }
+}
+
+/* As writeArray(). */
+static void writeArrayTo(OutputBuffer* out, SEXP arr) {
+  R_xlen_t len = XLENGTH(arr);
+  R_xlen_t i;
+
+  if (len == 0) {
+    writeTypeTo(out, "character");
+  } else if (TYPEOF(arr) == VECSXP) {
+    writeTypeTo(out, serdeType(VECTOR_ELT(arr, 0), out->rho));
+  } else {
+    writeTypeTo(out, plainClass(arr));
+  }
+  writeIntTo(out, (int) len);
+  for (i = 0; i < len; i++) {
+    if (TYPEOF(arr) == VECSXP) {
+      writeObjectTo(out, VECTOR_ELT(arr, i), 0);
+    } else {
+      writeAtomicElementTo(out, arr, i);
+    }
+  }
+}
+
+/* As writeList(). */
+static void writeListTo(OutputBuffer* out, SEXP list) {
+  R_xlen_t i;
+  writeIntTo(out, (int) XLENGTH(list));
+  for (i = 0; i < XLENGTH(list); i++) {
+    writeObjectTo(out, VECTOR_ELT(list, i), 1);
+  }
+}
+
+/* As writeObject(). */
+static void writeObjectTo(OutputBuffer* out, SEXP object, int writeType) {
+  SEXP bytes;
+  const char* type;
+  int atomic = TYPEOF(object) != NILSXP && TYPEOF(object) != RAWSXP && TYPEOF(object) != VECSXP;
+
+  if (!isPlain(object) || (atomic && XLENGTH(object) == 0)) {
+    /* Zero-length vectors are also left to R, where is.na() fails on them. */
+    SEXP call = PROTECT(lang3(install("serializeObject"), object, ScalarLogical(writeType)));
+    bytes = PROTECT(eval(call, out->rho));
+    writeBytesTo(out, RAW(bytes), XLENGTH(bytes));
+    UNPROTECT(2);
+    return;
+  }
+  if (atomic && firstIsNA(object)) {
+    object = R_NilValue;
+  }
+
+  type = serdeType(object, out->rho);
+  if (writeType) {
+    writeTypeTo(out, type);
+  }
+  if (strcmp(type, "array") == 0) {
+    writeArrayTo(out, object);
+  } else if (strcmp(type, "list") == 0) {
+    writeListTo(out, object);
+  } else if (TYPEOF(object) == RAWSXP) {
+    writeIntTo(out, (int) XLENGTH(object));
+    writeBytesTo(out, RAW(object), XLENGTH(object));
+  } else if (TYPEOF(object) != NILSXP) {
+    writeAtomicElementTo(out, object, 0);
+  }
+}
+
+/* encodeList(), with the output buffer in scratch memory. */
+static SEXP encodeListWithScratch(SEXP* args) {
+  SEXP list = args[0], rho = args[1];
+  OutputBuffer out;
+  SEXP result;
+
+  if (TYPEOF(list) != VECSXP) {
+    error("invalid input");
+  }
+  out.data = NULL;
+  out.len = 0;
+  out.capacity = 0;
+  out.rho = rho;
+  ensureCapacity(&out, 256);
+  writeListTo(&out, list);
+
+  result = allocVector(RAWSXP, out.len);
+  memcpy(RAW(result), out.data, out.len);
+  return result;
+}
+
+/*
+ * Serializes `list` as writeList() does and returns the bytes as a raw vector. The scratch
+ * memory is released even if the R functions called back for some objects fail.
+ */
+SEXP encodeList(SEXP list, SEXP rho) {
+  SEXP args[2];
+  args[0] = list;
+  args[1] = rho;
+  return callWithScratch(encodeListWithScratch, args);
+}
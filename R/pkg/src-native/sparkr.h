@@ -0,0 +1,80 @@
+/*
+ Licensed to the Apache Software Foundation (ASF) under one or more
+ contributor license agreements.  See the NOTICE file distributed with
+ this work for additional information regarding copyright ownership.
+ The ASF licenses this file to You under the Apache License, Version 2.0
+ (the "License"); you may not use this file except in compliance with
+ the License.  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+/*
+ * Functions shared by the C sources of the SparkR native library.
+ */
+
+#ifndef SPARKR_H
+#define SPARKR_H
+
+#include <stddef.h>
+
+#include <R.h>
+#include <Rinternals.h>
+
+/* scratch.c */
+/*
+ * The temporary buffers of the native routines come from scratch memory that is reused by the
+ * calls, instead of R_alloc(). A routine runs in callWithScratch(), which releases what it
+ * allocated when it returns or fails with an R error.
+ */
+typedef struct {
+  int chunk;
+  size_t used;
+  size_t base;
+} ScratchMark;
+ScratchMark scratchMark(void);
+/* Returns fun(args), and releases the scratch memory it allocated even if it fails. */
+SEXP callWithScratch(SEXP (*fun)(SEXP* args), SEXP* args);
+void scratchRelease(ScratchMark mark);
+void* scratchAlloc(size_t size);
+/* Grows a buffer, in place if it was the last one allocated. */
+void* scratchGrow(void* ptr, size_t oldSize, size_t newSize);
+SEXP resetScratch(void);
+
+/* string_hash_code.c */
+/* Chooses the fastest string hashing code for the CPU, called when the library is loaded. */
+void initStringHashing(void);
+int hashBytes(const char* str, R_xlen_t len);
+int hashDouble(double value);
+int hashString(SEXP charsxp);
+/*
+ * Hashes a key as hashCode() does in R, i.e. by its first element. Sets *supported to 0 and
+ * returns 0 for keys that cannot be hashed.
+ */
+int hashKey(SEXP key, int* supported);
+SEXP stringHashCode(SEXP string);
+SEXP hashCodes(SEXP keys);
+
+/* bucket_pairs.c */
+SEXP bucketPairs(SEXP pairs, SEXP buckets, SEXP numPartitions);
+
+/* group_keys.c */
+/* The key of a pair is its first element, or the object itself if it is atomic. */
+SEXP pairKey(SEXP pair);
+SEXP groupPairKeys(SEXP pairs);
+
+/* join_pairs.c */
+SEXP joinTaggedPairs(SEXP pairs, SEXP nulls);
+
+/* serde.c */
+SEXP decodeObjects(SEXP bytes, SEXP count, SEXP withKeys, SEXP rho);
+SEXP decodeColumns(SEXP bytes, SEXP colNames, SEXP withKeys, SEXP rho);
+SEXP encodeList(SEXP list, SEXP rho);
+
+#endif
@@ -16,34 +16,302 @@
 */
 
 /*
- * A C function for R extension which implements the Java String hash algorithm.
+ * C functions for R extension which implement the Java hashCode algorithms, so that keys are
+ * assigned the same hash codes (and thus partitions) in R and in the JVM. Strings are hashed
+ * by their UTF-16 code units, as java.lang.String does.
  * Refer to http://en.wikipedia.org/wiki/Java_hashCode%28%29#The_java.lang.String_hash_function
  *
  */
 
-#include <R.h>
-#include <Rinternals.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SPARKR_HASH_AVX2
+#include <immintrin.h>
+#endif
+
+#include "sparkr.h"
 
 /* for compatibility with R before 3.1 */
 #ifndef IS_SCALAR
 #define IS_SCALAR(x, type) (TYPEOF(x) == (type) && XLENGTH(x) == 1)
 #endif
 
+/* The bits of java.lang.Double.NaN, which Double.doubleToLongBits returns for every NaN. */
+#define JAVA_CANONICAL_NAN_BITS 0x7ff8000000000000ULL
+
+/* POWERS_OF_31[k] is 31^k modulo 2^32. */
+static const uint32_t POWERS_OF_31[17] = {
+  0x00000001U, 0x0000001FU, 0x000003C1U, 0x0000745FU, 0x000E1781U, 0x01B4D89FU, 0x34E63B41U,
+  0x67E12CDFU, 0x94446F01U, 0xF449711FU, 0x94E4B2C1U, 0x07B1A55FU, 0xEE830681U, 0xE1DDC99FU,
+  0x59DB6A41U, 0xE191DDDFU, 0x50A9DE01U
+};
+
+/*
+ * Hashes the bytes in blocks of 8, as h = 31^8 * h + 31^7 * b[0] + ... + 31 * b[6] + b[7],
+ * which equals 8 steps of h = 31 * h + b[i] but does not wait for the previous multiplication
+ * at every byte. With asciiOnly, stops at the first block that holds a non-ASCII byte. Adds to
+ * *hash and returns the number of bytes hashed, the rest being left to the caller.
+ */
+static R_xlen_t hashBlocksScalar(const unsigned char* bytes, R_xlen_t len, int asciiOnly,
+                                 uint32_t* hash) {
+  uint32_t h = *hash;
+  R_xlen_t i;
+
+  for (i = 0; i + 8 <= len; i += 8) {
+    const unsigned char* b = bytes + i;
+    uint64_t word;
+    memcpy(&word, b, sizeof(word));
+    if (asciiOnly && (word & 0x8080808080808080ULL) != 0) {
+      break;
+    }
+    h = h * POWERS_OF_31[8] +
+      b[0] * POWERS_OF_31[7] + b[1] * POWERS_OF_31[6] + b[2] * POWERS_OF_31[5] +
+      b[3] * POWERS_OF_31[4] + b[4] * POWERS_OF_31[3] + b[5] * POWERS_OF_31[2] +
+      b[6] * POWERS_OF_31[1] + b[7];
+  }
+  *hash = h;
+  return i;
+}
+
+#ifdef SPARKR_HASH_AVX2
+/*
+ * Same as hashBlocksScalar(), with blocks of 16 bytes multiplied by their powers of 31 in the
+ * 8 lanes of two AVX2 vectors.
+ */
+__attribute__((target("avx2")))
+static R_xlen_t hashBlocksAVX2(const unsigned char* bytes, R_xlen_t len, int asciiOnly,
+                               uint32_t* hash) {
+  const uint32_t* p = POWERS_OF_31;
+  const __m256i powersHigh = _mm256_setr_epi32(
+    (int) p[15], (int) p[14], (int) p[13], (int) p[12],
+    (int) p[11], (int) p[10], (int) p[9], (int) p[8]);
+  const __m256i powersLow = _mm256_setr_epi32(
+    (int) p[7], (int) p[6], (int) p[5], (int) p[4], (int) p[3], (int) p[2], (int) p[1], 1);
+  uint32_t h = *hash;
+  R_xlen_t i;
+
+  for (i = 0; i + 16 <= len; i += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i*) (bytes + i));
+    __m256i sum;
+    __m128i sum4;
+    if (asciiOnly && _mm_movemask_epi8(block) != 0) {
+      break;
+    }
+    sum = _mm256_add_epi32(
+      _mm256_mullo_epi32(_mm256_cvtepu8_epi32(block), powersHigh),
+      _mm256_mullo_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(block, 8)), powersLow));
+    sum4 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    sum4 = _mm_add_epi32(sum4, _mm_shuffle_epi32(sum4, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum4 = _mm_add_epi32(sum4, _mm_shuffle_epi32(sum4, _MM_SHUFFLE(2, 3, 0, 1)));
+    h = h * POWERS_OF_31[16] + (uint32_t) _mm_cvtsi128_si32(sum4);
+  }
+  *hash = h;
+  /* A remaining block of 8 bytes, or the ASCII half of the block that stopped the loop */
+  return i + hashBlocksScalar(bytes + i, len - i, asciiOnly, hash);
+}
+#endif
+
+/* The block hashing kernel, chosen by initStringHashing() for the CPU in use. */
+static R_xlen_t (*hashBlocks)(const unsigned char*, R_xlen_t, int, uint32_t*) =
+  hashBlocksScalar;
+
+void initStringHashing(void) {
+#ifdef SPARKR_HASH_AVX2
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    hashBlocks = hashBlocksAVX2;
+  }
+#endif
+}
+
+int hashBytes(const char* str, R_xlen_t len) {
+  const unsigned char* bytes = (const unsigned char*) str;
+  uint32_t hashCode = 0;
+  R_xlen_t i;
+
+  /* Unsigned arithmetic wraps around like Java's int arithmetic does. */
+  for (i = hashBlocks(bytes, len, 0, &hashCode); i < len; i++) {
+    hashCode = 31 * hashCode + bytes[i];
+  }
+  return (int) hashCode;
+}
+
+int hashDouble(double value) {
+  uint64_t bits;
+
+  if (ISNAN(value)) {
+    bits = JAVA_CANONICAL_NAN_BITS;
+  } else {
+    memcpy(&bits, &value, sizeof(bits));
+  }
+  return (int) (uint32_t) (bits ^ (bits >> 32));
+}
+
+/*
+ * Decodes the UTF-8 encoded code point at str[*pos] and advances *pos past it. Returns -1 if
+ * the bytes there are not well-formed UTF-8, i.e. truncated, overlong or surrogate sequences.
+ */
+static int decodeUTF8(const unsigned char* str, R_xlen_t len, R_xlen_t* pos) {
+  unsigned char lead = str[*pos];
+  int codePoint, numCont, i;
+
+  if (lead < 0x80) {
+    (*pos)++;
+    return lead;
+  } else if (lead >= 0xC2 && lead <= 0xDF) {
+    codePoint = lead & 0x1F;
+    numCont = 1;
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    codePoint = lead & 0x0F;
+    numCont = 2;
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    codePoint = lead & 0x07;
+    numCont = 3;
+  } else {
+    return -1;
+  }
+
+  if (*pos + numCont >= len) {
+    return -1;
+  }
+  for (i = 1; i <= numCont; i++) {
+    unsigned char cont = str[*pos + i];
+    if ((cont & 0xC0) != 0x80) {
+      return -1;
+    }
+    codePoint = (codePoint << 6) | (cont & 0x3F);
+  }
+
+  if ((numCont == 2 && (codePoint < 0x800 || (codePoint >= 0xD800 && codePoint <= 0xDFFF))) ||
+      (numCont == 3 && (codePoint < 0x10000 || codePoint > 0x10FFFF))) {
+    return -1;
+  }
+  *pos += numCont + 1;
+  return codePoint;
+}
+
+/*
+ * Java's String.hashCode over the UTF-16 code units of a UTF-8 encoded string: code points
+ * outside the Basic Multilingual Plane are hashed as a pair of surrogates. Strings that are
+ * not valid UTF-8 are hashed byte by byte, as utf16CodeUnits() in R does.
+ */
+static int hashUTF8(const char* str, R_xlen_t len) {
+  const unsigned char* bytes = (const unsigned char*) str;
+  uint32_t hashCode = 0;
+  R_xlen_t pos = 0;
+
+  while (pos < len) {
+    int codePoint = decodeUTF8(bytes, len, &pos);
+    if (codePoint < 0) {
+      return hashBytes(str, len);
+    }
+    if (codePoint >= 0x10000) {
+      codePoint -= 0x10000;
+      hashCode = 31 * hashCode + (0xD800 + (codePoint >> 10));
+      hashCode = 31 * hashCode + (0xDC00 + (codePoint & 0x3FF));
+    } else {
+      hashCode = 31 * hashCode + codePoint;
+    }
+  }
+  return (int) hashCode;
+}
+
+int hashString(SEXP charsxp) {
+  const unsigned char* bytes = (const unsigned char*) CHAR(charsxp);
+  R_xlen_t len = XLENGTH(charsxp), i;
+  uint32_t hashCode = 0;
+  const char* utf8;
+
+  /* Fast path: ASCII characters are single UTF-16 code units and need no decoding. */
+  for (i = hashBlocks(bytes, len, 1, &hashCode); i < len && bytes[i] < 0x80; i++) {
+    hashCode = 31 * hashCode + bytes[i];
+  }
+  if (i == len) {
+    return (int) hashCode;
+  }
+
+  if (getCharCE(charsxp) == CE_UTF8) {
+    return hashUTF8(CHAR(charsxp), len);
+  } else if (getCharCE(charsxp) == CE_BYTES) {
+    return hashBytes(CHAR(charsxp), len);
+  }
+  utf8 = translateCharUTF8(charsxp);
+  return hashUTF8(utf8, (R_xlen_t) strlen(utf8));
+}
+
+/*
+ * Hashes the i-th element of a vector key. Returns 0 and sets *supported to 0 for the types
+ * that hashCode() in R does not support either, including classed vectors such as factors.
+ */
+static int hashElement(SEXP key, R_xlen_t i, int* supported) {
+  if (!OBJECT(key)) {
+    switch (TYPEOF(key)) {
+    case INTSXP:
+      return INTEGER(key)[i];
+    case REALSXP:
+      return hashDouble(REAL(key)[i]);
+    case STRSXP:
+      return hashString(STRING_ELT(key, i));
+    default:
+      break;
+    }
+  }
+  *supported = 0;
+  return 0;
+}
+
+int hashKey(SEXP key, int* supported) {
+  /* Keys that are not vectors, e.g. NULL or functions, have no length to check. */
+  if (!isVector(key) || XLENGTH(key) == 0) {
+    *supported = 0;
+    return 0;
+  }
+  return hashElement(key, 0, supported);
+}
+
 SEXP stringHashCode(SEXP string) {
-  const char* str;
-  R_xlen_t len, i;
-  int hashCode = 0;
-  
   if (!IS_SCALAR(string, STRSXP)) {
     error("invalid input");
   }
-  
-  str = CHAR(asChar(string));
-  len = XLENGTH(asChar(string));
-  
+
+  return ScalarInteger(hashString(asChar(string)));
+}
+
+/*
+ * Vectorized hashCode: computes the hash code of every key in one call. `keys` is either an
+ * atomic vector, where every element is a key, or a list of keys, where the first element of
+ * each key is hashed, as hashCode() does in R.
+ */
+SEXP hashCodes(SEXP keys) {
+  R_xlen_t len = XLENGTH(keys), i;
+  R_xlen_t unsupported = 0;
+  SEXP result;
+  int* hashes;
+
+  if (TYPEOF(keys) != VECSXP && TYPEOF(keys) != INTSXP && TYPEOF(keys) != REALSXP &&
+      TYPEOF(keys) != STRSXP) {
+    error("invalid input");
+  }
+
+  result = PROTECT(allocVector(INTSXP, len));
+  hashes = INTEGER(result);
+
   for (i = 0; i < len; i++) {
-    hashCode = (hashCode << 5) - hashCode + *str++;
+    int supported = 1;
+    if (TYPEOF(keys) == VECSXP) {
+      hashes[i] = hashKey(VECTOR_ELT(keys, i), &supported);
+    } else {
+      hashes[i] = hashElement(keys, i, &supported);
+    }
+    unsupported += !supported;
+  }
+
+  if (unsupported > 0) {
+    warning("Could not hash %ld object(s), returning 0", (long) unsupported);
   }
 
-  return ScalarInteger(hashCode);
+  UNPROTECT(1);
+  return result;
 }
@@ -0,0 +1,38 @@
+#!/bin/bash
+
+#
+# Licensed to the Apache Software Foundation (ASF) under one or more
+# contributor license agreements.  See the NOTICE file distributed with
+# this work for additional information regarding copyright ownership.
+# The ASF licenses this file to You under the Apache License, Version 2.0
+# (the "License"); you may not use this file except in compliance with
+# the License.  You may obtain a copy of the License at
+#
+#    http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# Runs the SparkR benchmarks against the package installed in $FWDIR/lib by install-dev.sh,
+# without starting Spark. The results are written to benchmarks/results-<commit>.csv unless
+# --output is given; see benchmarks/benchmarks.R for the other options, e.g.
+#
+#   ./run-benchmarks.sh --baseline=benchmarks/results-<other commit>.csv
+
+set -o pipefail
+set -e
+
+FWDIR="$(cd "`dirname "${BASH_SOURCE[0]}"`"; pwd)"
+. "$FWDIR/find-r.sh"
+
+ARGS=("$@")
+if [[ ! " $* " =~ " --output=" ]]; then
+  COMMIT="$(git -C "$FWDIR" rev-parse --short HEAD 2>/dev/null || echo unknown)"
+  ARGS+=("--output=$FWDIR/benchmarks/results-$COMMIT.csv")
+fi
+
+R_LIBS="$FWDIR/lib" "$R_SCRIPT_PATH/Rscript" "$FWDIR/benchmarks/benchmarks.R" "${ARGS[@]}"
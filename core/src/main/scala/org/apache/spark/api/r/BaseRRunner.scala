@@ -18,12 +18,16 @@
 package org.apache.spark.api.r
 
 import java.io._
-import java.net.{InetAddress, ServerSocket}
-import java.util.Arrays
+import java.net.{InetAddress, ServerSocket, Socket}
+import java.util.{ArrayDeque, Arrays}
+import java.util.concurrent.TimeUnit
 
+import scala.collection.mutable
 import scala.io.Source
 import scala.util.Try
 
+import com.google.common.io.CountingInputStream
+
 import org.apache.spark._
 import org.apache.spark.broadcast.Broadcast
 import org.apache.spark.internal.Logging
@@ -43,10 +47,17 @@ private[spark] abstract class BaseRRunner[IN, OUT](
     numPartitions: Int,
     isDataFrame: Boolean,
     colNames: Array[String],
-    mode: Int)
+    mode: Int,
+    metrics: RWorkerMetrics)
   extends Logging {
   protected var bootTime: Double = _
   protected var dataStream: DataInputStream = _
+  protected var worker: RWorker = _
+  // The bytes sent to the worker for this task, and those it returned before this task
+  private var dataSent: ByteCountingOutputStream = _
+  private var dataReturnedBefore = 0L
+
+  private val reuseWorker = SparkEnv.get.conf.get(R_WORKER_REUSE)
 
   def compute(
       inputIterator: Iterator[IN],
@@ -54,6 +65,30 @@ private[spark] abstract class BaseRRunner[IN, OUT](
     // Timing start
     bootTime = System.currentTimeMillis / 1000.0
 
+    worker = (if (reuseWorker) BaseRRunner.takeIdleWorker() else None).getOrElse(startWorker())
+    if (reuseWorker) {
+      // A worker that did not complete its task cannot serve another one. The lease tells
+      // whether this task still holds it, as it may serve another task once it is released.
+      val taskWorker = worker
+      val taskLease = BaseRRunner.leaseOf(taskWorker)
+      Option(TaskContext.get()).foreach(_.addTaskCompletionListener[Unit] { _ =>
+        BaseRRunner.closeIfLeased(taskWorker, taskLease)
+      })
+    }
+
+    // A reused worker reads the input of every task from a socket of its own, so that it reads
+    // it until the end of the stream as the other workers do.
+    val output =
+      if (reuseWorker) openTaskSocket().getOutputStream else worker.inSocket.getOutputStream
+    dataSent = new ByteCountingOutputStream(output)
+    dataReturnedBefore = worker.dataReturned.getCount
+    newWriterThread(dataSent, inputIterator, partitionIndex).start()
+    dataStream = worker.dataStream
+
+    newReaderIterator(dataStream, worker.errThread)
+  }
+
+  private def startWorker(): RWorker = {
     // we expect two connections
     val serverSocket = new ServerSocket(0, 2, InetAddress.getByName("localhost"))
     val listenPort = serverSocket.getLocalPort()
@@ -66,23 +101,39 @@ private[spark] abstract class BaseRRunner[IN, OUT](
     // the lifecycle of them to avoid deadlock.
     // TODO: optimize it to use one socket
 
-    // the socket used to send out the input of task
     serverSocket.setSoTimeout(10000)
-    dataStream = try {
+    try {
+      // the socket used to send out the input of task
       val inSocket = serverSocket.accept()
       BaseRRunner.authHelper.authClient(inSocket)
-      newWriterThread(inSocket.getOutputStream(), inputIterator, partitionIndex).start()
 
       // the socket used to receive the output of task
       val outSocket = serverSocket.accept()
       BaseRRunner.authHelper.authClient(outSocket)
-      val inputStream = new BufferedInputStream(outSocket.getInputStream)
-      new DataInputStream(inputStream)
+      new RWorker(inSocket, outSocket, errThread)
     } finally {
       serverSocket.close()
     }
+  }
 
-    newReaderIterator(dataStream, errThread)
+  /**
+   * Opens the socket of the input of the next task of a reused worker, which connects to it
+   * when it reads its port from `inSocket`.
+   */
+  private def openTaskSocket(): Socket = {
+    val serverSocket = new ServerSocket(0, 1, InetAddress.getByName("localhost"))
+    try {
+      val control = new DataOutputStream(worker.inSocket.getOutputStream)
+      control.writeInt(serverSocket.getLocalPort)
+      control.flush()
+      serverSocket.setSoTimeout(10000)
+      val taskSocket = serverSocket.accept()
+      worker.taskSocket = taskSocket
+      BaseRRunner.authHelper.authClient(taskSocket)
+      taskSocket
+    } finally {
+      serverSocket.close()
+    }
   }
 
   /**
@@ -111,6 +162,15 @@ private[spark] abstract class BaseRRunner[IN, OUT](
     override def hasNext: Boolean = nextObj != null || {
       if (!eos) {
         nextObj = read()
+        if (eos) {
+          metrics.add(RWorkerMetrics.DATA_SENT, dataSent.count)
+          metrics.add(
+            RWorkerMetrics.DATA_RETURNED, worker.dataReturned.getCount - dataReturnedBefore)
+        }
+        if (eos && reuseWorker) {
+          // The worker wrote all of its output and waits for the next task.
+          BaseRRunner.releaseWorker(worker)
+        }
         hasNext
       } else {
         false
@@ -134,6 +194,49 @@ private[spark] abstract class BaseRRunner[IN, OUT](
      */
     protected def read(): OUT
 
+    /**
+     * Reads the timing data and the metrics the R worker sends after its output, logs the
+     * timing data and adds both to the metrics of the task.
+     */
+    protected def readTimingData(): Unit = {
+      val boot = stream.readDouble - bootTime
+      val init = stream.readDouble
+      val broadcast = stream.readDouble
+      val input = stream.readDouble
+      val compute = stream.readDouble
+      val output = stream.readDouble
+      val gc = stream.readDouble
+      val peakMemory = stream.readDouble
+      val numInputRows = stream.readDouble
+      val numOutputRows = stream.readDouble
+      val numGroups = stream.readDouble
+      val peakNativeScratch = stream.readDouble
+      logInfo(
+        ("Times: boot = %.3f s, init = %.3f s, broadcast = %.3f s, " +
+          "read-input = %.3f s, compute = %.3f s, write-output = %.3f s, " +
+          "total = %.3f s, gc = %.3f s").format(
+          boot,
+          init,
+          broadcast,
+          input,
+          compute,
+          output,
+          boot + init + broadcast + input + compute + output,
+          gc))
+
+      def toMillis(secs: Double): Long = math.round(secs * 1000)
+      metrics.add(RWorkerMetrics.SETUP_TIME, toMillis(boot + init + broadcast))
+      metrics.add(RWorkerMetrics.READ_INPUT_TIME, toMillis(input))
+      metrics.add(RWorkerMetrics.COMPUTE_TIME, toMillis(compute))
+      metrics.add(RWorkerMetrics.WRITE_OUTPUT_TIME, toMillis(output))
+      metrics.add(RWorkerMetrics.GC_TIME, toMillis(gc))
+      metrics.add(RWorkerMetrics.PEAK_MEMORY, peakMemory.toLong)
+      metrics.add(RWorkerMetrics.NUM_INPUT_ROWS, numInputRows.toLong)
+      metrics.add(RWorkerMetrics.NUM_OUTPUT_ROWS, numOutputRows.toLong)
+      metrics.add(RWorkerMetrics.NUM_GROUPS, numGroups.toLong)
+      metrics.add(RWorkerMetrics.PEAK_NATIVE_SCRATCH, peakNativeScratch.toLong)
+    }
+
     protected val handleException: PartialFunction[Throwable, OUT] = {
       case e: Exception =>
         var msg = "R unexpectedly exited."
@@ -177,14 +280,30 @@ private[spark] abstract class BaseRRunner[IN, OUT](
         dataOut.writeInt(func.length)
         dataOut.write(func)
 
-        dataOut.writeInt(broadcastVars.length)
+        // A reused worker keeps the broadcast variables of its previous tasks. Those this task
+        // needs are not sent again but marked by a length of -1, and the others are removed
+        // from the worker by sending their negated IDs minus one.
+        val newIds = broadcastVars.map(_.id).toSet
+        val removedIds = worker.broadcastIds.diff(newIds).toSeq
+        dataOut.writeInt(broadcastVars.length + removedIds.length)
+        removedIds.foreach { id =>
+          dataOut.writeInt(-id.toInt - 1)
+          worker.broadcastIds -= id
+        }
         broadcastVars.foreach { broadcast =>
           // TODO(shivaram): Read a Long in R to avoid this cast
           dataOut.writeInt(broadcast.id.toInt)
-          // TODO: Pass a byte array from R to avoid this cast ?
-          val broadcastByteArr = broadcast.value.asInstanceOf[Array[Byte]]
-          dataOut.writeInt(broadcastByteArr.length)
-          dataOut.write(broadcastByteArr)
+          if (worker.broadcastIds.contains(broadcast.id)) {
+            dataOut.writeInt(-1)
+          } else {
+            // TODO: Pass a byte array from R to avoid this cast ?
+            val broadcastByteArr = broadcast.value.asInstanceOf[Array[Byte]]
+            dataOut.writeInt(broadcastByteArr.length)
+            dataOut.write(broadcastByteArr)
+            if (reuseWorker) {
+              worker.broadcastIds += broadcast.id
+            }
+          }
         }
 
         dataOut.writeInt(numPartitions)
@@ -220,6 +339,7 @@ private[spark] abstract class BaseRRunner[IN, OUT](
 }
 
 private[spark] object SpecialLengths {
+  val END_OF_STREAM = 0
   val TIMING_DATA = -1
 }
 
@@ -254,6 +374,49 @@ private[spark] class BufferedStreamThread(
   }
 }
 
+/**
+ * The sockets of a running R worker. When workers are reused, a worker that completed its task
+ * waits for the next one in `BaseRRunner`, and remembers the broadcast variables it holds.
+ */
+private[r] class RWorker(
+    val inSocket: Socket,
+    val outSocket: Socket,
+    val errThread: BufferedStreamThread) {
+  val dataReturned = new CountingInputStream(outSocket.getInputStream)
+  val dataStream = new DataInputStream(new BufferedInputStream(dataReturned))
+  val broadcastIds = mutable.HashSet.empty[Long]
+  // Counts the times the worker was taken from and released to the idle workers, so that every
+  // task holds it under a lease of its own. Guarded by the lock of BaseRRunner.
+  var lease = 0L
+  // The socket of the input of the current task of a reused worker
+  @volatile var taskSocket: Socket = _
+  // When the worker completed its last task, in System.nanoTime()
+  var idleSince = 0L
+
+  def close(): Unit = {
+    Option(taskSocket).foreach(socket => Try(socket.close()))
+    Try(inSocket.close())
+    Try(outSocket.close())
+  }
+}
+
+/**
+ * Counts the bytes written to `out`, for the task thread to read once the writer thread is done.
+ */
+private[r] class ByteCountingOutputStream(out: OutputStream) extends FilterOutputStream(out) {
+  @volatile var count = 0L
+
+  override def write(b: Int): Unit = {
+    out.write(b)
+    count += 1
+  }
+
+  override def write(b: Array[Byte], off: Int, len: Int): Unit = {
+    out.write(b, off, len)
+    count += len
+  }
+}
+
 private[r] object BaseRRunner {
   // Because forking processes from Java is expensive, we prefer to launch
   // a single R daemon (daemon.R) and tell it to fork new workers for our tasks.
@@ -261,6 +424,68 @@ private[r] object BaseRRunner {
   // also fall back to launching workers (worker.R) directly.
   private[this] var errThread: BufferedStreamThread = _
   private[this] var daemonChannel: DataOutputStream = _
+  // Workers waiting for their next task, when workers are reused, from the longest idle one.
+  // Tasks take the last one, so that the others become idle long enough to be closed when fewer
+  // workers are needed.
+  private[this] val idleWorkers = new ArrayDeque[RWorker]()
+  private[this] var idleMonitor: Thread = _
+
+  def takeIdleWorker(): Option[RWorker] = synchronized {
+    Option(idleWorkers.pollLast()).map { worker =>
+      worker.lease += 1
+      worker
+    }
+  }
+
+  def leaseOf(worker: RWorker): Long = synchronized {
+    worker.lease
+  }
+
+  /** Closes the worker unless it was released since the task holding `lease` took it. */
+  def closeIfLeased(worker: RWorker, lease: Long): Unit = synchronized {
+    if (worker.lease == lease) {
+      worker.close()
+    }
+  }
+
+  def releaseWorker(worker: RWorker): Unit = synchronized {
+    worker.lease += 1
+    if (idleWorkers.size >= SparkEnv.get.conf.get(R_WORKER_MAX_IDLE)) {
+      // The worker exits when its sockets are closed.
+      worker.close()
+    } else {
+      worker.idleSince = System.nanoTime()
+      idleWorkers.addLast(worker)
+      startIdleMonitor()
+    }
+  }
+
+  /**
+   * Starts the thread that closes the workers that have been idle for longer than
+   * spark.r.worker.idleTimeout, unless it is running. Must be called while holding the lock.
+   */
+  private def startIdleMonitor(): Unit = {
+    if (idleMonitor == null) {
+      val idleTimeoutNs = TimeUnit.SECONDS.toNanos(SparkEnv.get.conf.get(R_WORKER_IDLE_TIMEOUT))
+      idleMonitor = new Thread("idle R worker monitor") {
+        setDaemon(true)
+
+        override def run(): Unit = {
+          while (true) {
+            Thread.sleep(math.min(TimeUnit.NANOSECONDS.toMillis(idleTimeoutNs), 10000))
+            BaseRRunner.synchronized {
+              val now = System.nanoTime()
+              while (!idleWorkers.isEmpty &&
+                  now - idleWorkers.peekFirst().idleSince > idleTimeoutNs) {
+                idleWorkers.pollFirst().close()
+              }
+            }
+          }
+        }
+      }
+      idleMonitor.start()
+    }
+  }
 
   private lazy val authHelper = {
     val conf = Option(SparkEnv.get).map(_.conf).getOrElse(new SparkConf())
@@ -286,6 +511,7 @@ private[r] object BaseRRunner {
     rCommand = sparkConf.get(R_COMMAND).orElse(Some(rCommand)).get
 
     val rConnectionTimeout = sparkConf.get(R_BACKEND_CONNECTION_TIMEOUT)
+    val rArrowOutputBatchSize = sparkConf.get(R_ARROW_OUTPUT_BATCH_SIZE)
     val rOptions = "--vanilla"
     val rLibDir = RUtils.sparkRPackagePath(isDriver = false)
     val rExecScript = rLibDir(0) + "/SparkR/worker/" + script
@@ -298,6 +524,16 @@ private[r] object BaseRRunner {
     pb.environment().put("SPARKR_RLIBDIR", rLibDir.mkString(","))
     pb.environment().put("SPARKR_WORKER_PORT", port.toString)
     pb.environment().put("SPARKR_BACKEND_CONNECTION_TIMEOUT", rConnectionTimeout.toString)
+    pb.environment().put("SPARKR_ARROW_OUTPUT_BATCH_SIZE", rArrowOutputBatchSize.toString)
+    pb.environment().put("SPARKR_WORKER_REUSE", sparkConf.get(R_WORKER_REUSE).toString)
+    pb.environment().put("SPARKR_SHUFFLE_COMBINE_MEMORY",
+      sparkConf.get(R_SHUFFLE_COMBINE_MEMORY).toString)
+    pb.environment().put("SPARKR_SERIALIZATION_NATIVE_ENDIAN",
+      sparkConf.get(R_SERIALIZATION_NATIVE_ENDIAN).toString)
+    pb.environment().put("SPARKR_SERIALIZATION_COMPRESSION",
+      sparkConf.get(R_SERIALIZATION_COMPRESSION))
+    pb.environment().put("SPARKR_DAEMON_PRELOAD_PACKAGES",
+      sparkConf.get(R_DAEMON_PRELOAD_PACKAGES).mkString(","))
     pb.environment().put("SPARKR_SPARKFILES_ROOT_DIR", SparkFiles.getRootDirectory())
     pb.environment().put("SPARKR_IS_RUNNING_ON_WORKER", "TRUE")
     pb.environment().put("SPARKR_WORKER_SECRET", authHelper.secret)
@@ -307,28 +543,48 @@ private[r] object BaseRRunner {
     errThread
   }
 
+  private def useDaemon: Boolean = {
+    !Utils.isWindows && SparkEnv.get.conf.getBoolean("spark.sparkr.use.daemon", true)
+  }
+
+  // Launches the daemon unless it is running. Must be called while holding the lock.
+  private def startDaemon(): Unit = {
+    if (daemonChannel == null) {
+      // we expect one connections
+      val serverSocket = new ServerSocket(0, 1, InetAddress.getByName("localhost"))
+      val daemonPort = serverSocket.getLocalPort
+      errThread = createRProcess(daemonPort, "daemon.R")
+      // the socket used to send out the input of task
+      serverSocket.setSoTimeout(10000)
+      val sock = serverSocket.accept()
+      try {
+        authHelper.authClient(sock)
+        daemonChannel = new DataOutputStream(new BufferedOutputStream(sock.getOutputStream))
+      } finally {
+        serverSocket.close()
+      }
+    }
+  }
+
+  /**
+   * Launches the daemon, if workers are forked by one, before the first task needs it, so that
+   * the first tasks do not wait for R to start and load SparkR and the preloaded packages.
+   */
+  def prewarmDaemon(): Unit = {
+    if (useDaemon) {
+      synchronized {
+        startDaemon()
+      }
+    }
+  }
+
   /**
    * ProcessBuilder used to launch worker R processes.
    */
   def createRWorker(port: Int): BufferedStreamThread = {
-    val useDaemon = SparkEnv.get.conf.getBoolean("spark.sparkr.use.daemon", true)
-    if (!Utils.isWindows && useDaemon) {
+    if (useDaemon) {
       synchronized {
-        if (daemonChannel == null) {
-          // we expect one connections
-          val serverSocket = new ServerSocket(0, 1, InetAddress.getByName("localhost"))
-          val daemonPort = serverSocket.getLocalPort
-          errThread = createRProcess(daemonPort, "daemon.R")
-          // the socket used to send out the input of task
-          serverSocket.setSoTimeout(10000)
-          val sock = serverSocket.accept()
-          try {
-            authHelper.authClient(sock)
-            daemonChannel = new DataOutputStream(new BufferedOutputStream(sock.getOutputStream))
-          } finally {
-            serverSocket.close()
-          }
-        }
+        startDaemon()
         try {
           daemonChannel.writeInt(port)
           daemonChannel.flush()
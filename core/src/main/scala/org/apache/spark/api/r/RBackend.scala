@@ -42,6 +42,7 @@ private[spark] class RBackend {
   private[this] var channelFuture: ChannelFuture = null
   private[this] var bootstrap: ServerBootstrap = null
   private[this] var bossGroup: EventLoopGroup = null
+  private[this] var backendHandler: RBackendHandler = null
 
   /** Tracks JVM objects returned to R for this RBackend instance. */
   private[r] val jvmObjectTracker = new JVMObjectTracker
@@ -52,6 +53,7 @@ private[spark] class RBackend {
     bossGroup = new NioEventLoopGroup(conf.get(R_NUM_BACKEND_THREADS))
     val workerGroup = bossGroup
     val handler = new RBackendHandler(this)
+    backendHandler = handler
     val authHelper = new RAuthHelper(conf)
 
     bootstrap = new ServerBootstrap()
@@ -100,6 +102,10 @@ private[spark] class RBackend {
       bootstrap.config().childGroup().shutdownGracefully()
     }
     bootstrap = null
+    if (backendHandler != null) {
+      backendHandler.close()
+      backendHandler = null
+    }
     jvmObjectTracker.clear()
   }
 
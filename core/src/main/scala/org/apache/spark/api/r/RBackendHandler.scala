@@ -18,13 +18,14 @@
 package org.apache.spark.api.r
 
 import java.io.{ByteArrayInputStream, ByteArrayOutputStream, DataInputStream, DataOutputStream}
-import java.util.concurrent.TimeUnit
+import java.util.concurrent.{Callable, ConcurrentHashMap, ExecutionException, Future, TimeUnit}
+import java.util.concurrent.atomic.AtomicLong
 
 import io.netty.channel.{ChannelHandlerContext, SimpleChannelInboundHandler}
 import io.netty.channel.ChannelHandler.Sharable
 import io.netty.handler.timeout.ReadTimeoutException
 
-import org.apache.spark.{SparkConf, SparkEnv}
+import org.apache.spark.{SparkConf, SparkContext, SparkEnv}
 import org.apache.spark.api.r.SerDe._
 import org.apache.spark.internal.Logging
 import org.apache.spark.internal.config.R._
@@ -39,6 +40,16 @@ import org.apache.spark.util.{ThreadUtils, Utils}
 private[r] class RBackendHandler(server: RBackend)
   extends SimpleChannelInboundHandler[Array[Byte]] with Logging {
 
+  // The calls started by "invokeAsync" by their IDs, until they are awaited, or forgotten since
+  // their handles were garbage collected in R. Each one results in its reply, as written by
+  // handleMethodCall.
+  private val asyncCalls = new ConcurrentHashMap[String, Future[Array[Byte]]]()
+  private val nextAsyncCallId = new AtomicLong(0)
+  private val asyncCallExecutor = {
+    val conf = Option(SparkEnv.get).map(_.conf).getOrElse(new SparkConf())
+    ThreadUtils.newDaemonCachedThreadPool("SparkRAsyncCall", conf.get(R_NUM_BACKEND_ASYNC_THREADS))
+  }
+
   override def channelRead0(ctx: ChannelHandlerContext, msg: Array[Byte]): Unit = {
     val bis = new ByteArrayInputStream(msg)
     val dis = new DataInputStream(bis)
@@ -67,10 +78,13 @@ private[r] class RBackendHandler(server: RBackend)
           server.close()
         case "rm" =>
           try {
-            val t = readObjectType(dis)
-            assert(t == 'c')
-            val objToRemove = readString(dis)
-            server.jvmObjectTracker.remove(JVMObjectId(objToRemove))
+            // Either one object ID, or an array of them to remove several objects at once
+            val objsToRemove = readObjectType(dis) match {
+              case 'c' => Array(readString(dis))
+              case 'a' => readArray(dis, server.jvmObjectTracker).asInstanceOf[Array[String]]
+              case t => throw new IllegalArgumentException(s"Invalid type $t")
+            }
+            objsToRemove.foreach(id => server.jvmObjectTracker.remove(JVMObjectId(id)))
             writeInt(dos, 0)
             writeObject(dos, null, server.jvmObjectTracker)
           } catch {
@@ -79,32 +93,64 @@ private[r] class RBackendHandler(server: RBackend)
               writeInt(dos, -1)
               writeString(dos, s"Removing $objId failed: ${e.getMessage}")
           }
+        case "invokeBatch" =>
+          // The arguments are the calls to invoke, see handleMethodCalls.
+          withHeartbeat(ctx) {
+            writeInt(dos, 0)
+            handleMethodCalls(numArgs, dis, dos)
+          }
+        case "invokeAsync" =>
+          // The argument is a call to invoke in the background, written as in "invokeBatch".
+          // Replies with the ID of the call right away.
+          val callId = submitAsyncCall(dis)
+          writeInt(dos, 0)
+          writeObject(dos, callId, server.jvmObjectTracker)
+        case "pollAsync" =>
+          val callId = readArgs(numArgs, dis)(0).asInstanceOf[String]
+          Option(asyncCalls.get(callId)) match {
+            case Some(call) =>
+              writeInt(dos, 0)
+              writeObject(dos, java.lang.Boolean.valueOf(call.isDone), server.jvmObjectTracker)
+            case None =>
+              writeInt(dos, -1)
+              writeString(dos, s"Error: unknown asynchronous call $callId")
+          }
+        case "awaitAsync" =>
+          // Replies with the reply of the call once it is done, and forgets the call.
+          val callId = readArgs(numArgs, dis)(0).asInstanceOf[String]
+          Option(asyncCalls.remove(callId)) match {
+            case Some(call) =>
+              withHeartbeat(ctx) {
+                try {
+                  dos.write(call.get())
+                } catch {
+                  case e: ExecutionException =>
+                    logError(s"Asynchronous call $callId failed", e.getCause)
+                    writeInt(dos, -1)
+                    writeString(dos, Utils.exceptionString(e.getCause))
+                }
+              }
+            case None =>
+              writeInt(dos, -1)
+              writeString(dos, s"Error: unknown asynchronous call $callId")
+          }
+        case "forgetAsync" =>
+          // Either one call ID, or an array of them. The calls still running are not cancelled.
+          val callIds = readArgs(numArgs, dis)(0) match {
+            case id: String => Array(id)
+            case ids: Array[_] => ids.map(_.toString)
+          }
+          callIds.foreach(id => asyncCalls.remove(id))
+          writeInt(dos, 0)
+          writeObject(dos, null, server.jvmObjectTracker)
         case _ =>
           dos.writeInt(-1)
           writeString(dos, s"Error: unknown method $methodName")
       }
     } else {
-      // To avoid timeouts when reading results in SparkR driver, we will be regularly sending
-      // heartbeat responses. We use special code +1 to signal the client that backend is
-      // alive and it should continue blocking for result.
-      val execService = ThreadUtils.newDaemonSingleThreadScheduledExecutor("SparkRKeepAliveThread")
-      val pingRunner = new Runnable {
-        override def run(): Unit = {
-          val pingBaos = new ByteArrayOutputStream()
-          val pingDaos = new DataOutputStream(pingBaos)
-          writeInt(pingDaos, +1)
-          ctx.write(pingBaos.toByteArray)
-        }
+      withHeartbeat(ctx) {
+        handleMethodCall(isStatic, objId, methodName, numArgs, dis, dos)
       }
-      val conf = Option(SparkEnv.get).map(_.conf).getOrElse(new SparkConf())
-      val heartBeatInterval = conf.get(R_HEARTBEAT_INTERVAL)
-      val backendConnectionTimeout = conf.get(R_BACKEND_CONNECTION_TIMEOUT)
-      val interval = Math.min(heartBeatInterval, backendConnectionTimeout - 1)
-
-      execService.scheduleAtFixedRate(pingRunner, interval, interval, TimeUnit.SECONDS)
-      handleMethodCall(isStatic, objId, methodName, numArgs, dis, dos)
-      execService.shutdown()
-      execService.awaitTermination(1, TimeUnit.SECONDS)
     }
 
     val reply = bos.toByteArray
@@ -127,13 +173,85 @@ private[r] class RBackendHandler(server: RBackend)
     }
   }
 
+  // To avoid timeouts when reading results in SparkR driver, we will be regularly sending
+  // heartbeat responses while running `body`. We use special code +1 to signal the client that
+  // backend is alive and it should continue blocking for result.
+  private def withHeartbeat(ctx: ChannelHandlerContext)(body: => Unit): Unit = {
+    val execService = ThreadUtils.newDaemonSingleThreadScheduledExecutor("SparkRKeepAliveThread")
+    val pingRunner = new Runnable {
+      override def run(): Unit = {
+        val pingBaos = new ByteArrayOutputStream()
+        val pingDaos = new DataOutputStream(pingBaos)
+        writeInt(pingDaos, +1)
+        ctx.write(pingBaos.toByteArray)
+      }
+    }
+    val conf = Option(SparkEnv.get).map(_.conf).getOrElse(new SparkConf())
+    val heartBeatInterval = conf.get(R_HEARTBEAT_INTERVAL)
+    val backendConnectionTimeout = conf.get(R_BACKEND_CONNECTION_TIMEOUT)
+    val interval = Math.min(heartBeatInterval, backendConnectionTimeout - 1)
+
+    execService.scheduleAtFixedRate(pingRunner, interval, interval, TimeUnit.SECONDS)
+    try {
+      body
+    } finally {
+      execService.shutdown()
+      execService.awaitTermination(1, TimeUnit.SECONDS)
+    }
+  }
+
+  // Stops the calls still running and forgets all of them, as the backend is closed.
+  def close(): Unit = {
+    asyncCallExecutor.shutdownNow()
+    asyncCalls.clear()
+  }
+
+  // Starts the call of an "invokeAsync" message on a thread of its own and returns its ID. The
+  // jobs of the call get the local properties of the SparkContext that the calls invoked so far
+  // set, e.g. the job group, as if they were run by the thread of the backend.
+  private def submitAsyncCall(dis: DataInputStream): String = {
+    val callId = s"async-${nextAsyncCallId.incrementAndGet()}"
+    val activeContext = SparkContext.getActive
+    val properties = activeContext.map(sc => Utils.cloneProperties(sc.getLocalProperties))
+    val call = asyncCallExecutor.submit(new Callable[Array[Byte]] {
+      override def call(): Array[Byte] = {
+        for (sc <- activeContext; props <- properties) {
+          sc.setLocalProperties(props)
+        }
+        val bos = new ByteArrayOutputStream()
+        handleMethodCalls(1, dis, new DataOutputStream(bos))
+        bos.toByteArray
+      }
+    })
+    asyncCalls.put(callId, call)
+    callId
+  }
+
+  // Invokes the calls of an "invokeBatch" message in order. Each call is written as a single
+  // method call message without the length, i.e. isStatic, objId, methodName and the arguments,
+  // and its reply is written as handleMethodCall does. The calls following a failed one are
+  // skipped, so that the reply ends with the error of the failed call.
+  def handleMethodCalls(numCalls: Int, dis: DataInputStream, dos: DataOutputStream): Unit = {
+    var i = 0
+    var succeeded = true
+    while (i < numCalls && succeeded) {
+      val isStatic = readBoolean(dis)
+      val objId = readString(dis)
+      val methodName = readString(dis)
+      val numArgs = readInt(dis)
+      succeeded = handleMethodCall(isStatic, objId, methodName, numArgs, dis, dos)
+      i += 1
+    }
+  }
+
+  // Returns whether the call succeeded.
   def handleMethodCall(
       isStatic: Boolean,
       objId: String,
       methodName: String,
       numArgs: Int,
       dis: DataInputStream,
-      dos: DataOutputStream): Unit = {
+      dos: DataOutputStream): Boolean = {
     var obj: Object = null
     try {
       val cls = if (isStatic) {
@@ -189,6 +307,7 @@ private[r] class RBackendHandler(server: RBackend)
       } else {
         throw new IllegalArgumentException("invalid method " + methodName + " for object " + objId)
       }
+      true
     } catch {
       case e: Exception =>
         logError(s"$methodName on $objId failed", e)
@@ -196,6 +315,7 @@ private[r] class RBackendHandler(server: RBackend)
         // Writing the error message of the cause for the exception. This will be returned
         // to user in the R process.
         writeString(dos, Utils.exceptionString(e.getCause))
+        false
     }
   }
 
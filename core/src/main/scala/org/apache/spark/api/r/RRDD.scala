@@ -17,7 +17,7 @@
 
 package org.apache.spark.api.r
 
-import java.io.{File, OutputStream}
+import java.io.{DataOutputStream, File, OutputStream}
 import java.net.Socket
 import java.util.{Map => JMap}
 
@@ -25,7 +25,7 @@ import scala.collection.JavaConverters._
 import scala.reflect.ClassTag
 
 import org.apache.spark._
-import org.apache.spark.api.java.{JavaPairRDD, JavaRDD, JavaSparkContext}
+import org.apache.spark.api.java.{JavaPairRDD, JavaRDD, JavaRDDLike, JavaSparkContext}
 import org.apache.spark.broadcast.Broadcast
 import org.apache.spark.internal.Logging
 import org.apache.spark.rdd.RDD
@@ -40,11 +40,15 @@ private abstract class BaseRRDD[T: ClassTag, U: ClassTag](
     packageNames: Array[Byte],
     broadcastVars: Array[Broadcast[Object]])
   extends RDD[U](parent) with Logging {
+  // Created on the driver, and shipped to the tasks with this RDD
+  private val workerMetrics = RWorkerMetrics.accumulators(sparkContext)
+
   override def getPartitions: Array[Partition] = parent.partitions
 
   override def compute(partition: Partition, context: TaskContext): Iterator[U] = {
     val runner = new RRunner[T, U](
-      func, deserializer, serializer, packageNames, broadcastVars, numPartitions)
+      func, deserializer, serializer, packageNames, broadcastVars, numPartitions,
+      metrics = workerMetrics)
 
     // The parent may be also an RRDD, so we should launch it first.
     val parentIterator = firstParent[T].iterator(partition, context)
@@ -164,6 +168,38 @@ private[spark] object RRDD {
     JavaRDD.readRDDFromFile(jsc, fileName, parallelism)
   }
 
+  /**
+   * Collects the elements of an RDD and serves them to R over a socket, rather than returning
+   * them as a list that R fetches with a call per element. This is used by collectRDD() on R
+   * side. The number of elements is written first, and then each element as 0 followed by the
+   * object itself, or as 1 followed by the key and the value for the tuples of pair RDDs.
+   */
+  def collectAndServe(rdd: JavaRDDLike[_, _]): Array[Any] = {
+    val collected = rdd.rdd.collect()
+    // Fail here rather than in the serving thread, so that R gets the error of this call.
+    collected.foreach {
+      case (_: Array[Byte], _: Array[Byte]) | _: Array[Byte] | _: String | _: java.lang.Integer |
+           _: java.lang.Long | _: java.lang.Double | _: java.lang.Boolean | null =>
+      case other =>
+        throw new IllegalArgumentException(
+          s"Collecting elements of ${other.getClass} is not supported for RDDs in R")
+    }
+    serveToStream("serve-RDD") { outputStream =>
+      val out = new DataOutputStream(outputStream)
+      out.writeInt(collected.length)
+      collected.foreach {
+        case (key, value) =>
+          out.writeInt(1)
+          SerDe.writeObject(out, key.asInstanceOf[AnyRef], jvmObjectTracker = null)
+          SerDe.writeObject(out, value.asInstanceOf[AnyRef], jvmObjectTracker = null)
+        case obj =>
+          out.writeInt(0)
+          SerDe.writeObject(out, obj.asInstanceOf[AnyRef], jvmObjectTracker = null)
+      }
+      out.flush()
+    }
+  }
+
   private[spark] def serveToStream(
       threadName: String)(writeFunc: OutputStream => Unit): Array[Any] = {
     SocketAuthServer.serveToStream(threadName, new RAuthHelper(SparkEnv.get.conf))(writeFunc)
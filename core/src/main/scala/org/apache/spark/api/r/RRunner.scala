@@ -34,7 +34,8 @@ private[spark] class RRunner[IN, OUT](
     numPartitions: Int = -1,
     isDataFrame: Boolean = false,
     colNames: Array[String] = null,
-    mode: Int = RRunnerModes.RDD)
+    mode: Int = RRunnerModes.RDD,
+    metrics: RWorkerMetrics = RWorkerMetrics.empty)
   extends BaseRRunner[IN, OUT](
     func,
     deserializer,
@@ -44,7 +45,8 @@ private[spark] class RRunner[IN, OUT](
     numPartitions,
     isDataFrame,
     colNames,
-    mode) {
+    mode,
+    metrics) {
 
   protected def newReaderIterator(
       dataStream: DataInputStream, errThread: BufferedStreamThread): ReaderIterator = {
@@ -99,24 +101,8 @@ private[spark] class RRunner[IN, OUT](
 
           length match {
             case SpecialLengths.TIMING_DATA =>
-              // Timing data from R worker
-              val boot = dataStream.readDouble - bootTime
-              val init = dataStream.readDouble
-              val broadcast = dataStream.readDouble
-              val input = dataStream.readDouble
-              val compute = dataStream.readDouble
-              val output = dataStream.readDouble
-              logInfo(
-                ("Times: boot = %.3f s, init = %.3f s, broadcast = %.3f s, " +
-                  "read-input = %.3f s, compute = %.3f s, write-output = %.3f s, " +
-                  "total = %.3f s").format(
-                  boot,
-                  init,
-                  broadcast,
-                  input,
-                  compute,
-                  output,
-                  boot + init + broadcast + input + compute + output))
+              // Timing data and metrics from R worker
+              readTimingData()
               read()
             case length if length > 0 =>
               readData(length).asInstanceOf[OUT]
@@ -158,15 +144,31 @@ private[spark] class RRunner[IN, OUT](
           }
         }
 
+        // Writes the rows of a group of gapply followed by its key in frames of a length and that
+        // many bytes, so that the R worker reads and processes the groups one at a time. The last
+        // frame of a group, which ends with the key, has a negative length.
+        val groupFrame = new ByteArrayOutputStream()
+        def writeGroup(key: Any, rows: Iterator[_]): Unit = {
+          for (row <- rows) {
+            groupFrame.write(row.asInstanceOf[Array[Byte]])
+            if (groupFrame.size() >= RRunner.GROUP_FRAME_SIZE) {
+              dataOut.writeInt(groupFrame.size())
+              groupFrame.writeTo(dataOut)
+              groupFrame.reset()
+            }
+          }
+          // Writes key which can be used as a boundary in group-aggregate
+          groupFrame.write('r')
+          groupFrame.write(key.asInstanceOf[Array[Byte]])
+          dataOut.writeInt(-groupFrame.size())
+          groupFrame.writeTo(dataOut)
+          groupFrame.reset()
+        }
+
         for (elem <- iter) {
           elem match {
             case (key, innerIter: Iterator[_]) =>
-              for (innerElem <- innerIter) {
-                writeElem(innerElem)
-              }
-              // Writes key which can be used as a boundary in group-aggregate
-              dataOut.writeByte('r')
-              writeElem(key)
+              writeGroup(key, innerIter)
             case (key, value) =>
               writeElem(key)
               writeElem(value)
@@ -178,3 +180,8 @@ private[spark] class RRunner[IN, OUT](
     }
   }
 }
+
+private object RRunner {
+  // The number of bytes of rows of a gapply group buffered before they are written as a frame
+  val GROUP_FRAME_SIZE = 1 << 20
+}
@@ -20,11 +20,14 @@ package org.apache.spark.api.r
 import java.io.File
 import java.util.Arrays
 
+import scala.util.control.NonFatal
+
 import org.apache.spark.{SparkEnv, SparkException}
 import org.apache.spark.api.java.JavaSparkContext
+import org.apache.spark.internal.Logging
 import org.apache.spark.internal.config._
 
-private[spark] object RUtils {
+private[spark] object RUtils extends Logging {
   // Local path where R binary packages built from R source code contained in the spark
   // packages specified with "--packages" or "--jars" command line option reside.
   var rPackages: Option[String] = None
@@ -110,4 +113,23 @@ private[spark] object RUtils {
   def isEncryptionEnabled(sc: JavaSparkContext): Boolean = {
     sc.conf.get(org.apache.spark.internal.config.IO_ENCRYPTION_ENABLED)
   }
+
+  /**
+   * Launches the daemon that forks the R workers of this executor in the background, so that
+   * it is ready for the first R tasks. See spark.r.daemon.prewarm.
+   */
+  def prewarmRDaemon(): Unit = {
+    val thread = new Thread("SparkR daemon prewarm") {
+      override def run(): Unit = {
+        try {
+          BaseRRunner.prewarmDaemon()
+        } catch {
+          case NonFatal(e) =>
+            logWarning("Failed to launch the R daemon, R tasks will launch it instead", e)
+        }
+      }
+    }
+    thread.setDaemon(true)
+    thread.start()
+  }
 }
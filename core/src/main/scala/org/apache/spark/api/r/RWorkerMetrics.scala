@@ -0,0 +1,126 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package org.apache.spark.api.r
+
+import org.apache.spark.SparkContext
+import org.apache.spark.util.AccumulatorV2
+
+/**
+ * Receives the metrics of the tasks run by R workers, which `BaseRRunner` reports after each
+ * task: the bytes sent to and returned from the worker, the time taken by its stages, and what
+ * the worker itself reports after its output. Every metric is named by one of
+ * [[RWorkerMetrics.metrics]].
+ */
+private[spark] trait RWorkerMetrics extends Serializable {
+  def add(name: String, value: Long): Unit
+}
+
+private[spark] object RWorkerMetrics {
+  val DATA_SENT = "dataSent"
+  val DATA_RETURNED = "dataReturned"
+  val SETUP_TIME = "setupTime"
+  val READ_INPUT_TIME = "readInputTime"
+  val COMPUTE_TIME = "computeTime"
+  val WRITE_OUTPUT_TIME = "writeOutputTime"
+  val GC_TIME = "gcTime"
+  val PEAK_MEMORY = "peakMemory"
+  val NUM_INPUT_ROWS = "numInputRows"
+  val NUM_OUTPUT_ROWS = "numOutputRows"
+  val NUM_GROUPS = "numGroups"
+  val PEAK_NATIVE_SCRATCH = "peakNativeScratch"
+
+  /** The names and descriptions of the metrics. Times are in milliseconds. */
+  val metrics: Seq[(String, String)] = Seq(
+    DATA_SENT -> "data sent to R workers",
+    DATA_RETURNED -> "data returned from R workers",
+    SETUP_TIME -> "R worker setup time",
+    READ_INPUT_TIME -> "R worker input deserialization time",
+    COMPUTE_TIME -> "R worker compute time",
+    WRITE_OUTPUT_TIME -> "R worker output serialization time",
+    GC_TIME -> "R worker GC time",
+    PEAK_MEMORY -> "R worker peak memory",
+    NUM_INPUT_ROWS -> "number of input rows of R workers",
+    NUM_OUTPUT_ROWS -> "number of output rows of R workers",
+    NUM_GROUPS -> "number of groups of R workers",
+    PEAK_NATIVE_SCRATCH -> "R worker peak native scratch memory")
+
+  /** Metrics that are only logged by `BaseRRunner`. */
+  val empty: RWorkerMetrics = new RWorkerMetrics {
+    override def add(name: String, value: Long): Unit = {}
+  }
+
+  /**
+   * Creates named accumulators for the metrics, which show up for the stages that update them
+   * in the UI and in the event logs. Must be called on the driver.
+   */
+  def accumulators(sc: SparkContext): RWorkerMetrics = {
+    val adders: Map[String, Long => Unit] = metrics.map { case (name, description) =>
+      if (name == PEAK_MEMORY || name == PEAK_NATIVE_SCRATCH) {
+        val accumulator = new MaxLongAccumulator
+        sc.register(accumulator, description)
+        name -> ((value: Long) => accumulator.add(value))
+      } else {
+        val accumulator = sc.longAccumulator(description)
+        name -> ((value: Long) => accumulator.add(value))
+      }
+    }.toMap
+    new RWorkerMetrics {
+      override def add(name: String, value: Long): Unit = adders(name)(value)
+    }
+  }
+}
+
+/**
+ * An accumulator of the largest value added to it, for the peak memory of R workers, which
+ * would make no sense summed up over the tasks of a stage.
+ */
+private[r] class MaxLongAccumulator extends AccumulatorV2[Long, Long] {
+  private var _max = 0L
+  private var _isZero = true
+
+  override def isZero: Boolean = _isZero
+
+  override def copy(): MaxLongAccumulator = {
+    val newAcc = new MaxLongAccumulator
+    newAcc._max = _max
+    newAcc._isZero = _isZero
+    newAcc
+  }
+
+  override def reset(): Unit = {
+    _max = 0L
+    _isZero = true
+  }
+
+  override def add(v: Long): Unit = {
+    _max = math.max(_max, v)
+    _isZero = false
+  }
+
+  override def merge(other: AccumulatorV2[Long, Long]): Unit = other match {
+    case o: MaxLongAccumulator =>
+      if (!o.isZero) {
+        add(o.value)
+      }
+    case _ =>
+      throw new UnsupportedOperationException(
+        s"Cannot merge ${this.getClass.getName} with ${other.getClass.getName}")
+  }
+
+  override def value: Long = _max
+}
@@ -18,6 +18,7 @@
 package org.apache.spark.api.r
 
 import java.io.{DataInputStream, DataOutputStream}
+import java.nio.ByteBuffer
 import java.nio.charset.StandardCharsets
 import java.sql.{Date, Time, Timestamp}
 
@@ -167,19 +168,60 @@ private[spark] object SerDe {
     (0 until len).map(_ => readBytes(in)).toArray
   }
 
+  // Arrays of numbers and booleans are read and written through a ByteBuffer a block of
+  // elements at a time, rather than one element at a time through the stream.
+  private val ARRAY_BLOCK_SIZE = 8192
+
+  private def readBlocks(in: DataInputStream, len: Int, elemSize: Int)(
+      read: (ByteBuffer, Int, Int) => Unit): Unit = {
+    val bytes = new Array[Byte](math.min(len, ARRAY_BLOCK_SIZE) * elemSize)
+    var offset = 0
+    while (offset < len) {
+      val n = math.min(len - offset, ARRAY_BLOCK_SIZE)
+      in.readFully(bytes, 0, n * elemSize)
+      read(ByteBuffer.wrap(bytes, 0, n * elemSize), offset, n)
+      offset += n
+    }
+  }
+
+  private def writeBlocks(out: DataOutputStream, len: Int, elemSize: Int)(
+      write: (ByteBuffer, Int, Int) => Unit): Unit = {
+    val bytes = new Array[Byte](math.min(len, ARRAY_BLOCK_SIZE) * elemSize)
+    var offset = 0
+    while (offset < len) {
+      val n = math.min(len - offset, ARRAY_BLOCK_SIZE)
+      write(ByteBuffer.wrap(bytes, 0, n * elemSize), offset, n)
+      out.write(bytes, 0, n * elemSize)
+      offset += n
+    }
+  }
+
   def readIntArr(in: DataInputStream): Array[Int] = {
     val len = readInt(in)
-    (0 until len).map(_ => readInt(in)).toArray
+    val arr = new Array[Int](len)
+    readBlocks(in, len, 4) { (buf, offset, n) => buf.asIntBuffer().get(arr, offset, n) }
+    arr
   }
 
   def readDoubleArr(in: DataInputStream): Array[Double] = {
     val len = readInt(in)
-    (0 until len).map(_ => readDouble(in)).toArray
+    val arr = new Array[Double](len)
+    readBlocks(in, len, 8) { (buf, offset, n) => buf.asDoubleBuffer().get(arr, offset, n) }
+    arr
   }
 
   def readBooleanArr(in: DataInputStream): Array[Boolean] = {
     val len = readInt(in)
-    (0 until len).map(_ => readBoolean(in)).toArray
+    val arr = new Array[Boolean](len)
+    readBlocks(in, len, 4) { (buf, offset, n) =>
+      val ints = buf.asIntBuffer()
+      var i = 0
+      while (i < n) {
+        arr(offset + i) = ints.get(i) != 0
+        i += 1
+      }
+    }
+    arr
   }
 
   def readStringArr(in: DataInputStream): Array[String] = {
@@ -470,19 +512,30 @@ private[spark] object SerDe {
   def writeIntArr(out: DataOutputStream, value: Array[Int]): Unit = {
     writeType(out, "integer")
     out.writeInt(value.length)
-    value.foreach(v => out.writeInt(v))
+    writeBlocks(out, value.length, 4) { (buf, offset, n) =>
+      buf.asIntBuffer().put(value, offset, n)
+    }
   }
 
   def writeDoubleArr(out: DataOutputStream, value: Array[Double]): Unit = {
     writeType(out, "double")
     out.writeInt(value.length)
-    value.foreach(v => out.writeDouble(v))
+    writeBlocks(out, value.length, 8) { (buf, offset, n) =>
+      buf.asDoubleBuffer().put(value, offset, n)
+    }
   }
 
   def writeBooleanArr(out: DataOutputStream, value: Array[Boolean]): Unit = {
     writeType(out, "logical")
     out.writeInt(value.length)
-    value.foreach(v => writeBoolean(out, v))
+    writeBlocks(out, value.length, 4) { (buf, offset, n) =>
+      val ints = buf.asIntBuffer()
+      var i = 0
+      while (i < n) {
+        ints.put(i, if (value(offset + i)) 1 else 0)
+        i += 1
+      }
+    }
   }
 
   def writeStringArr(out: DataOutputStream, value: Array[String]): Unit = {
@@ -37,9 +37,11 @@ import com.google.common.util.concurrent.ThreadFactoryBuilder
 import org.slf4j.MDC
 
 import org.apache.spark._
+import org.apache.spark.api.r.RUtils
 import org.apache.spark.deploy.SparkHadoopUtil
 import org.apache.spark.internal.Logging
 import org.apache.spark.internal.config._
+import org.apache.spark.internal.config.R.R_DAEMON_PREWARM
 import org.apache.spark.internal.plugin.PluginContainer
 import org.apache.spark.memory.{SparkOutOfMemoryError, TaskMemoryManager}
 import org.apache.spark.metrics.source.JVMCPUSource
@@ -227,6 +229,10 @@ private[spark] class Executor(
 
   metricsPoller.start()
 
+  if (conf.get(R_DAEMON_PREWARM)) {
+    RUtils.prewarmRDaemon()
+  }
+
   private[executor] def numRunningTasks: Int = runningTasks.size()
 
   /**
@@ -16,6 +16,10 @@
  */
 package org.apache.spark.internal.config
 
+import java.util.concurrent.TimeUnit
+
+import org.apache.spark.network.util.ByteUnit
+
 private[spark] object R {
 
   val R_BACKEND_CONNECTION_TIMEOUT = ConfigBuilder("spark.r.backendConnectionTimeout")
@@ -28,11 +32,68 @@ private[spark] object R {
     .intConf
     .createWithDefault(2)
 
+  val R_NUM_BACKEND_ASYNC_THREADS = ConfigBuilder("spark.r.numRBackendAsyncThreads")
+    .version("3.1.0")
+    .intConf
+    .checkValue(_ > 0, "The number of threads must be positive.")
+    .createWithDefault(8)
+
   val R_HEARTBEAT_INTERVAL = ConfigBuilder("spark.r.heartBeatInterval")
     .version("2.1.0")
     .intConf
     .createWithDefault(100)
 
+  val R_ARROW_OUTPUT_BATCH_SIZE = ConfigBuilder("spark.r.arrow.outputBatchSize")
+    .version("3.1.0")
+    .intConf
+    .checkValue(_ > 0, "The number of rows must be positive.")
+    .createWithDefault(10000)
+
+  val R_WORKER_REUSE = ConfigBuilder("spark.r.worker.reuse")
+    .version("3.1.0")
+    .booleanConf
+    .createWithDefault(false)
+
+  val R_WORKER_MAX_IDLE = ConfigBuilder("spark.r.worker.maxIdle")
+    .version("3.1.0")
+    .intConf
+    .checkValue(_ >= 0, "The number of idle workers must not be negative.")
+    .createWithDefault(8)
+
+  val R_WORKER_IDLE_TIMEOUT = ConfigBuilder("spark.r.worker.idleTimeout")
+    .version("3.1.0")
+    .timeConf(TimeUnit.SECONDS)
+    .checkValue(_ > 0, "The idle timeout must be positive.")
+    .createWithDefaultString("60s")
+
+  val R_SHUFFLE_COMBINE_MEMORY = ConfigBuilder("spark.r.shuffle.combineMemory")
+    .version("3.1.0")
+    .bytesConf(ByteUnit.BYTE)
+    .checkValue(_ > 0, "The memory limit must be positive.")
+    .createWithDefaultString("64m")
+
+  val R_SERIALIZATION_NATIVE_ENDIAN = ConfigBuilder("spark.r.serialization.nativeEndian")
+    .version("3.1.0")
+    .booleanConf
+    .createWithDefault(false)
+
+  val R_SERIALIZATION_COMPRESSION = ConfigBuilder("spark.r.serialization.compression")
+    .version("3.1.0")
+    .stringConf
+    .checkValues(Set("none", "gzip", "bzip2", "xz"))
+    .createWithDefault("none")
+
+  val R_DAEMON_PREWARM = ConfigBuilder("spark.r.daemon.prewarm")
+    .version("3.1.0")
+    .booleanConf
+    .createWithDefault(false)
+
+  val R_DAEMON_PRELOAD_PACKAGES = ConfigBuilder("spark.r.daemon.preloadPackages")
+    .version("3.1.0")
+    .stringConf
+    .toSequence
+    .createWithDefault(Nil)
+
   val SPARKR_COMMAND = ConfigBuilder("spark.sparkr.r.command")
     .version("1.5.3")
     .stringConf
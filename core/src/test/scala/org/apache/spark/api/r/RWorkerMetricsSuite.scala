@@ -0,0 +1,43 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package org.apache.spark.api.r
+
+import org.apache.spark.SparkFunSuite
+
+class RWorkerMetricsSuite extends SparkFunSuite {
+  test("MaxLongAccumulator keeps the largest value") {
+    val acc = new MaxLongAccumulator
+    assert(acc.isZero)
+    acc.add(3L)
+    acc.add(1L)
+    assert(!acc.isZero)
+    assert(acc.value === 3L)
+
+    val other = new MaxLongAccumulator
+    acc.merge(other)
+    assert(acc.value === 3L)
+    other.add(7L)
+    acc.merge(other)
+    assert(acc.value === 7L)
+
+    val copied = acc.copy()
+    acc.reset()
+    assert(acc.isZero)
+    assert(copied.value === 7L)
+  }
+}
@@ -0,0 +1,70 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package org.apache.spark.api.r
+
+import java.io.{ByteArrayInputStream, ByteArrayOutputStream, DataInputStream, DataOutputStream}
+
+import org.apache.spark.SparkFunSuite
+
+class SerDeSuite extends SparkFunSuite {
+  private def toBytes(write: DataOutputStream => Unit): Array[Byte] = {
+    val bytes = new ByteArrayOutputStream()
+    val out = new DataOutputStream(bytes)
+    write(out)
+    out.flush()
+    bytes.toByteArray
+  }
+
+  private def fromBytes[T](bytes: Array[Byte])(read: DataInputStream => T): T = {
+    read(new DataInputStream(new ByteArrayInputStream(bytes)))
+  }
+
+  test("arrays of numbers and booleans are written and read in bulk") {
+    // Around and beyond the number of elements that are read and written at a time
+    Seq(0, 1, 8191, 8192, 8193, 20000).foreach { len =>
+      val ints = Array.tabulate(len)(i => i * 31 - 1000)
+      val doubles = Array.tabulate(len)(i => i / 3.0)
+      val booleans = Array.tabulate(len)(i => i % 3 == 0)
+
+      // The same bytes as the elements written one at a time after the type and the length
+      val intBytes = toBytes(SerDe.writeIntArr(_, ints))
+      assert(intBytes === toBytes { out =>
+        SerDe.writeType(out, "integer")
+        out.writeInt(len)
+        ints.foreach(out.writeInt)
+      })
+      val doubleBytes = toBytes(SerDe.writeDoubleArr(_, doubles))
+      assert(doubleBytes === toBytes { out =>
+        SerDe.writeType(out, "double")
+        out.writeInt(len)
+        doubles.foreach(out.writeDouble)
+      })
+      val booleanBytes = toBytes(SerDe.writeBooleanArr(_, booleans))
+      assert(booleanBytes === toBytes { out =>
+        SerDe.writeType(out, "logical")
+        out.writeInt(len)
+        booleans.foreach(SerDe.writeBoolean(out, _))
+      })
+
+      // Past the type written before the array
+      assert(fromBytes(intBytes.drop(1))(SerDe.readIntArr) === ints)
+      assert(fromBytes(doubleBytes.drop(1))(SerDe.readDoubleArr) === doubles)
+      assert(fromBytes(booleanBytes.drop(1))(SerDe.readBooleanArr) === booleans)
+    }
+  }
+}
@@ -18,17 +18,21 @@
 package org.apache.spark.sql.api.r
 
 import java.io.{ByteArrayInputStream, ByteArrayOutputStream, DataInputStream, DataOutputStream}
+import java.net.Socket
+import java.nio.channels.Channels
 import java.util.{Locale, Map => JMap}
 
 import scala.collection.JavaConverters._
+import scala.collection.mutable.ArrayBuffer
 import scala.util.matching.Regex
 
-import org.apache.spark.SparkContext
+import org.apache.spark.{SparkContext, SparkEnv}
 import org.apache.spark.api.java.{JavaRDD, JavaSparkContext}
-import org.apache.spark.api.r.SerDe
+import org.apache.spark.api.r.{RAuthHelper, RRDD, SerDe}
 import org.apache.spark.broadcast.Broadcast
 import org.apache.spark.internal.Logging
 import org.apache.spark.rdd.RDD
+import org.apache.spark.security.SocketAuthServer
 import org.apache.spark.sql._
 import org.apache.spark.sql.catalyst.expressions.{ExprUtils, GenericRowWithSchema}
 import org.apache.spark.sql.catalyst.parser.CatalystSqlParser
@@ -149,6 +153,24 @@ private[sql] object SQLUtils extends Logging {
   // TODO: introduce a user defined type for serialized R data.
   val SERIALIZED_R_DATA_SCHEMA = StructType(Seq(StructField("R", BinaryType)))
 
+  /**
+   * Serves the result of dapplyCollect() or gapplyCollect() with Arrow optimization to R.
+   * The values of its single column of serialized R data are Arrow streams written by the R
+   * workers, which are sent in order, each prefixed by its length, and then a zero length.
+   */
+  def serveSerializedArrowToR(df: DataFrame): Array[Any] = {
+    RRDD.serveToStream("serve-Arrow") { outputStream =>
+      val out = new DataOutputStream(outputStream)
+      df.toLocalIterator().asScala.foreach { row =>
+        val stream = row.getAs[Array[Byte]](0)
+        out.writeInt(stream.length)
+        out.write(stream)
+      }
+      out.writeInt(0)
+      out.flush()
+    }
+  }
+
   /**
    * The helper function for dapply() on R side.
    */
@@ -260,3 +282,28 @@ private[sql] object SQLUtils extends Logging {
     ArrowConverters.toDataFrame(arrowBatchRDD, schema.json, sparkSession.sqlContext)
   }
 }
+
+/**
+ * Helper for making an `RDD` of serialized ArrowRecordBatches from data sent from R over a
+ * socket, in preference to writing the data to a temporary file. R sends one Arrow stream per
+ * slice of its data frame, each prefixed with its length, followed by a length of 0; every
+ * record batch in those streams becomes a partition.
+ */
+private[sql] class RArrowStreamServer(sparkSession: SparkSession)
+    extends SocketAuthServer[JavaRDD[Array[Byte]]](
+      new RAuthHelper(SparkEnv.get.conf), "sparkr-arrow-server") {
+
+  override def handleConnection(sock: Socket): JavaRDD[Array[Byte]] = {
+    val in = new DataInputStream(sock.getInputStream())
+    val batches = new ArrayBuffer[Array[Byte]]
+    var length = in.readInt()
+    while (length > 0) {
+      val stream = new Array[Byte](length)
+      in.readFully(stream)
+      batches ++= ArrowConverters.getBatchesFromStream(
+        Channels.newChannel(new ByteArrayInputStream(stream)))
+      length = in.readInt()
+    }
+    JavaRDD.fromRDD(sparkSession.sparkContext.parallelize(batches.toSeq, batches.length))
+  }
+}
@@ -17,11 +17,13 @@
 
 package org.apache.spark.sql.execution
 
-import java.io.{ByteArrayOutputStream, DataOutputStream}
+import java.io.DataOutputStream
 
 import scala.collection.JavaConverters._
 import scala.language.existentials
 
+import org.apache.arrow.vector.VectorSchemaRoot
+
 import org.apache.spark.api.java.function.MapFunction
 import org.apache.spark.api.r._
 import org.apache.spark.broadcast.Broadcast
@@ -35,7 +37,7 @@ import org.apache.spark.sql.catalyst.expressions.objects.Invoke
 import org.apache.spark.sql.catalyst.plans.logical.{EventTimeWatermark, FunctionUtils, LogicalGroupState}
 import org.apache.spark.sql.catalyst.plans.physical._
 import org.apache.spark.sql.execution.python.BatchIterator
-import org.apache.spark.sql.execution.r.ArrowRRunner
+import org.apache.spark.sql.execution.r.{ArrowRRunner, RWorkerSQLMetrics}
 import org.apache.spark.sql.execution.streaming.GroupStateImpl
 import org.apache.spark.sql.internal.SQLConf
 import org.apache.spark.sql.streaming.GroupStateTimeout
@@ -215,9 +217,12 @@ case class MapPartitionsInRWithArrowExec(
 
   private val batchSize = conf.arrowMaxRecordsPerBatch
 
+  override lazy val metrics = RWorkerSQLMetrics.create(sparkContext)
+
   override def outputPartitioning: Partitioning = child.outputPartitioning
 
   override protected def doExecute(): RDD[InternalRow] = {
+    val workerMetrics = RWorkerSQLMetrics.toWorkerMetrics(metrics)
     child.execute().mapPartitionsInternal { inputIter =>
       val outputTypes = schema.map(_.dataType)
 
@@ -226,7 +231,8 @@ case class MapPartitionsInRWithArrowExec(
         if (batchSize > 0) new BatchIterator(inputIter, batchSize) else Iterator(inputIter)
 
       val runner = new ArrowRRunner(func, packageNames, broadcastVars, inputSchema,
-        SQLConf.get.sessionLocalTimeZone, RRunnerModes.DATAFRAME_DAPPLY)
+        SQLConf.get.sessionLocalTimeZone, RRunnerModes.DATAFRAME_DAPPLY,
+        keepOutputSerialized = schema == SERIALIZED_R_DATA_SCHEMA, metrics = workerMetrics)
 
       // The communication mechanism is as follows:
       //
@@ -447,6 +453,8 @@ case class FlatMapGroupsInRExec(
     outputObjAttr: Attribute,
     child: SparkPlan) extends UnaryExecNode with ObjectProducerExec {
 
+  override lazy val metrics = RWorkerSQLMetrics.create(sparkContext)
+
   override def outputPartitioning: Partitioning = child.outputPartitioning
 
   override def requiredChildDistribution: Seq[Distribution] =
@@ -466,6 +474,7 @@ case class FlatMapGroupsInRExec(
     } else {
       SerializationFormats.BYTE
     }
+    val workerMetrics = RWorkerSQLMetrics.toWorkerMetrics(metrics)
 
     child.execute().mapPartitionsInternal { iter =>
       val grouped = GroupedIterator(iter, groupingAttributes, child.output)
@@ -475,7 +484,7 @@ case class FlatMapGroupsInRExec(
       val runner = new RRunner[(Array[Byte], Iterator[Array[Byte]]), Array[Byte]](
         func, SerializationFormats.ROW, serializerForR, packageNames, broadcastVars,
         isDataFrame = true, colNames = inputSchema.fieldNames,
-        mode = RRunnerModes.DATAFRAME_GAPPLY)
+        mode = RRunnerModes.DATAFRAME_GAPPLY, metrics = workerMetrics)
 
       val groupedRBytes = grouped.map { case (key, rowIter) =>
         val deserializedIter = rowIter.map(getValue)
@@ -512,6 +521,8 @@ case class FlatMapGroupsInRWithArrowExec(
     keyDeserializer: Expression,
     groupingAttributes: Seq[Attribute],
     child: SparkPlan) extends UnaryExecNode {
+  override lazy val metrics = RWorkerSQLMetrics.create(sparkContext)
+
   override def outputPartitioning: Partitioning = child.outputPartitioning
 
   override def producedAttributes: AttributeSet = AttributeSet(output)
@@ -527,24 +538,27 @@ case class FlatMapGroupsInRWithArrowExec(
     Seq(groupingAttributes.map(SortOrder(_, Ascending)))
 
   override protected def doExecute(): RDD[InternalRow] = {
+    val workerMetrics = RWorkerSQLMetrics.toWorkerMetrics(metrics)
     child.execute().mapPartitionsInternal { iter =>
       val grouped = GroupedIterator(iter, groupingAttributes, child.output)
       val getKey = ObjectOperator.deserializeRowToObject(keyDeserializer, groupingAttributes)
 
-      val keys = collection.mutable.ArrayBuffer.empty[Array[Byte]]
+      // Keys of the groups whose rows were taken from `groupedByRKey` but not written yet.
+      val keys = collection.mutable.Queue.empty[Array[Byte]]
       val groupedByRKey: Iterator[Iterator[InternalRow]] =
         grouped.map { case (key, rowIter) =>
-          keys.append(rowToRBytes(getKey(key).asInstanceOf[Row]))
+          keys.enqueue(rowToRBytes(getKey(key).asInstanceOf[Row]))
           rowIter
         }
 
       val runner = new ArrowRRunner(func, packageNames, broadcastVars, inputSchema,
-        SQLConf.get.sessionLocalTimeZone, RRunnerModes.DATAFRAME_GAPPLY) {
-        protected override def bufferedWrite(
-            dataOut: DataOutputStream)(writeFunc: ByteArrayOutputStream => Unit): Unit = {
-          super.bufferedWrite(dataOut)(writeFunc)
-          // Don't forget we're sending keys additionally.
-          keys.foreach(dataOut.write)
+        SQLConf.get.sessionLocalTimeZone, RRunnerModes.DATAFRAME_GAPPLY,
+        keepOutputSerialized = schema == SERIALIZED_R_DATA_SCHEMA, metrics = workerMetrics) {
+        protected override def writeBatch(
+            dataOut: DataOutputStream, root: VectorSchemaRoot): Unit = {
+          super.writeBatch(dataOut, root)
+          // Don't forget we're sending the key of the group additionally.
+          dataOut.write(keys.dequeue())
         }
       }
 
@@ -553,15 +567,15 @@ case class FlatMapGroupsInRWithArrowExec(
       //    JVM side                           R side
       //
       // 1. Group internal rows
-      // 2. Grouped internal rows    --------> Arrow record batches
-      // 3. Grouped keys             --------> Regular serialized keys
-      // 4.                                    Converts each Arrow record batch to each R data frame
-      // 5.                                    Deserializes keys
-      // 6.                                    Maps each key to each R Data frame
-      // 7.                                    Computes R native function on each key/R data frame
-      // 8.                                    Converts all R data frames to Arrow record batches
-      // 9. Columnar batches         <-------- Arrow record batches
-      // 10. Each row from each batch
+      // 2. Grouped internal rows    --------> An Arrow record batch per group
+      // 3. Grouped keys             --------> Regular serialized key after each batch
+      // 4.                                    Converts each Arrow record batch to an R data frame
+      // 5.                                    Deserializes its key
+      // 6.                                    Computes R native function on the key/R data frame
+      //                                       and goes on with the next group
+      // 7.                                    Converts all R data frames to Arrow record batches
+      // 8. Columnar batches         <-------- Arrow record batches
+      // 9. Each row from each batch
       //
       // Note that, unlike Python vectorization implementation, R side sends Arrow formatted
       // binary in a batch due to the limitation of R API. See also ARROW-4512.
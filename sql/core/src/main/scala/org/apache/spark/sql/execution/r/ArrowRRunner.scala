@@ -22,7 +22,7 @@ import java.nio.channels.Channels
 
 import scala.collection.JavaConverters._
 
-import org.apache.arrow.vector.VectorSchemaRoot
+import org.apache.arrow.vector.{VarBinaryVector, VectorSchemaRoot}
 import org.apache.arrow.vector.ipc.{ArrowStreamReader, ArrowStreamWriter}
 import org.apache.arrow.vector.util.ByteArrayReadableSeekableByteChannel
 
@@ -40,6 +40,10 @@ import org.apache.spark.util.Utils
 
 /**
  * Similar to `ArrowPythonRunner`, but exchange data with R worker via Arrow stream.
+ *
+ * With `keepOutputSerialized`, the Arrow streams sent back by the R worker are not read but
+ * returned as rows of a single binary column, for outputs whose schema is not known, e.g.
+ * for dapplyCollect() and gapplyCollect().
  */
 class ArrowRRunner(
     func: Array[Byte],
@@ -47,7 +51,9 @@ class ArrowRRunner(
     broadcastVars: Array[Broadcast[Object]],
     schema: StructType,
     timeZoneId: String,
-    mode: Int)
+    mode: Int,
+    keepOutputSerialized: Boolean = false,
+    metrics: RWorkerMetrics = RWorkerMetrics.empty)
   extends BaseRRunner[Iterator[InternalRow], ColumnarBatch](
     func,
     "arrow",
@@ -57,19 +63,22 @@ class ArrowRRunner(
     numPartitions = -1,
     isDataFrame = true,
     schema.fieldNames,
-    mode) {
-
-  protected def bufferedWrite(
-      dataOut: DataOutputStream)(writeFunc: ByteArrayOutputStream => Unit): Unit = {
+    mode,
+    metrics) {
+
+  /**
+   * Writes the record batch in `root` as a length-prefixed Arrow stream of its own, holding the
+   * schema and this batch only. The R worker reads and releases the batches one at a time,
+   * since it cannot read an Arrow stream incrementally from a socket connection. See ARROW-4512.
+   */
+  protected def writeBatch(dataOut: DataOutputStream, root: VectorSchemaRoot): Unit = {
     val out = new ByteArrayOutputStream()
-    writeFunc(out)
-
-    // Currently, there looks no way to read batch by batch by socket connection in R side,
-    // See ARROW-4512. Therefore, it writes the whole Arrow streaming-formatted binary at
-    // once for now.
-    val data = out.toByteArray
-    dataOut.writeInt(data.length)
-    dataOut.write(data)
+    val writer = new ArrowStreamWriter(root, null, Channels.newChannel(out))
+    writer.start()
+    writer.writeBatch()
+    writer.end()
+    dataOut.writeInt(out.size())
+    out.writeTo(dataOut)
   }
 
   protected override def newWriterThread(
@@ -88,30 +97,26 @@ class ArrowRRunner(
             "stdout writer for R", 0, Long.MaxValue)
           val root = VectorSchemaRoot.create(arrowSchema, allocator)
 
-          bufferedWrite(dataOut) { out =>
-            Utils.tryWithSafeFinally {
-              val arrowWriter = ArrowWriter.create(root)
-              val writer = new ArrowStreamWriter(root, null, Channels.newChannel(out))
-              writer.start()
+          Utils.tryWithSafeFinally {
+            val arrowWriter = ArrowWriter.create(root)
 
-              while (inputIterator.hasNext) {
-                val nextBatch: Iterator[InternalRow] = inputIterator.next()
+            while (inputIterator.hasNext) {
+              val nextBatch: Iterator[InternalRow] = inputIterator.next()
 
-                while (nextBatch.hasNext) {
-                  arrowWriter.write(nextBatch.next())
-                }
-
-                arrowWriter.finish()
-                writer.writeBatch()
-                arrowWriter.reset()
+              while (nextBatch.hasNext) {
+                arrowWriter.write(nextBatch.next())
               }
-              writer.end()
-            } {
-              // Don't close root and allocator in TaskCompletionListener to prevent
-              // a race condition. See `ArrowPythonRunner`.
-              root.close()
-              allocator.close()
+
+              arrowWriter.finish()
+              writeBatch(dataOut, root)
+              arrowWriter.reset()
             }
+            dataOut.writeInt(SpecialLengths.END_OF_STREAM)
+          } {
+            // Don't close root and allocator in TaskCompletionListener to prevent
+            // a race condition. See `ArrowPythonRunner`.
+            root.close()
+            allocator.close()
           }
         }
       }
@@ -127,14 +132,36 @@ class ArrowRRunner(
       private var reader: ArrowStreamReader = _
       private var root: VectorSchemaRoot = _
       private var vectors: Array[ColumnVector] = _
+      // Holds the last Arrow stream returned as is, when `keepOutputSerialized` is set.
+      private var serializedVector: VarBinaryVector = _
 
       TaskContext.get().addTaskCompletionListener[Unit] { _ =>
         if (reader != null) {
           reader.close(false)
         }
+        if (serializedVector != null) {
+          serializedVector.close()
+        }
         allocator.close()
       }
 
+      /**
+       * Returns an Arrow stream written by the R worker, without reading it, as a single row of
+       * one binary column. The previous one has been consumed by then.
+       */
+      private def serializedBatch(stream: Array[Byte]): ColumnarBatch = {
+        if (serializedVector != null) {
+          serializedVector.close()
+        }
+        serializedVector = new VarBinaryVector("R", allocator)
+        serializedVector.allocateNew()
+        serializedVector.setSafe(0, stream)
+        serializedVector.setValueCount(1)
+        val batch = new ColumnarBatch(Array[ColumnVector](new ArrowColumnVector(serializedVector)))
+        batch.setNumRows(1)
+        batch
+      }
+
       private var batchLoaded = true
 
       protected override def read(): ColumnarBatch = try {
@@ -146,45 +173,35 @@ class ArrowRRunner(
             batch
           } else {
             reader.close(false)
-            allocator.close()
-            // Should read timing data after this.
+            reader = null
+            // Should read the next Arrow stream, if any, or timing data after this.
             read()
           }
         } else {
           dataStream.readInt() match {
             case SpecialLengths.TIMING_DATA =>
-              // Timing data from R worker
-              val boot = dataStream.readDouble - bootTime
-              val init = dataStream.readDouble
-              val broadcast = dataStream.readDouble
-              val input = dataStream.readDouble
-              val compute = dataStream.readDouble
-              val output = dataStream.readDouble
-              logInfo(
-                ("Times: boot = %.3f s, init = %.3f s, broadcast = %.3f s, " +
-                  "read-input = %.3f s, compute = %.3f s, write-output = %.3f s, " +
-                  "total = %.3f s").format(
-                  boot,
-                  init,
-                  broadcast,
-                  input,
-                  compute,
-                  output,
-                  boot + init + broadcast + input + compute + output))
+              // Timing data and metrics from R worker
+              readTimingData()
               read()
             case length if length > 0 =>
               // Likewise, there looks no way to send each batch in streaming format via socket
               // connection. See ARROW-4512.
-              // So, it reads the whole Arrow streaming-formatted binary at once for now.
+              // So, it reads each Arrow streaming-formatted binary at once. The R worker may
+              // send several of them, e.g. as gapply() writes its output incrementally.
               val buffer = new Array[Byte](length)
               dataStream.readFully(buffer)
-              val in = new ByteArrayReadableSeekableByteChannel(buffer)
-              reader = new ArrowStreamReader(in, allocator)
-              root = reader.getVectorSchemaRoot
-              vectors = root.getFieldVectors.asScala.map { vector =>
-                new ArrowColumnVector(vector)
-              }.toArray[ColumnVector]
-              read()
+              if (keepOutputSerialized) {
+                serializedBatch(buffer)
+              } else {
+                val in = new ByteArrayReadableSeekableByteChannel(buffer)
+                reader = new ArrowStreamReader(in, allocator)
+                batchLoaded = true
+                root = reader.getVectorSchemaRoot
+                vectors = root.getFieldVectors.asScala.map { vector =>
+                  new ArrowColumnVector(vector)
+                }.toArray[ColumnVector]
+                read()
+              }
             case length if length == 0 =>
               // End of stream
               eos = true
@@ -0,0 +1,46 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package org.apache.spark.sql.execution.r
+
+import org.apache.spark.SparkContext
+import org.apache.spark.api.r.RWorkerMetrics
+import org.apache.spark.api.r.RWorkerMetrics._
+import org.apache.spark.sql.execution.metric.{SQLMetric, SQLMetrics}
+
+/**
+ * The metrics of the R workers of a physical operator running an R function, as SQL metrics
+ * shown for that operator in the UI.
+ */
+private[sql] object RWorkerSQLMetrics {
+
+  def create(sc: SparkContext): Map[String, SQLMetric] = RWorkerMetrics.metrics.map {
+    case (name, description) =>
+      val metric = name match {
+        case DATA_SENT | DATA_RETURNED | PEAK_MEMORY | PEAK_NATIVE_SCRATCH =>
+          SQLMetrics.createSizeMetric(sc, description)
+        case NUM_INPUT_ROWS | NUM_OUTPUT_ROWS | NUM_GROUPS =>
+          SQLMetrics.createMetric(sc, description)
+        case _ => SQLMetrics.createTimingMetric(sc, description)
+      }
+      name -> metric
+  }.toMap
+
+  def toWorkerMetrics(metrics: Map[String, SQLMetric]): RWorkerMetrics = new RWorkerMetrics {
+    override def add(name: String, value: Long): Unit = metrics(name) += value
+  }
+}